@@ -0,0 +1,73 @@
+/**
+ * @file shm_consumer.cpp
+ * @brief Example consumer of a ddist shared-memory ring.
+ *
+ * @details Reads packets published by `ddist --shm` and writes 
+ *          them to a PCAP file, reporting overruns. Exits once 
+ *          ddist has finished and all packets were read, or 
+ *          with an error if ddist died before finishing.
+ *
+ *          USAGE: shm_consumer <ringName> [output.pcap]
+ */
+#include <iostream>
+#include <fstream>
+#include <stdexcept>
+#include <ctime>
+#include "ShmRing.h"
+
+int main(int argc, char* argv[]) {
+    if (argc != 2 && argc != 3) {
+        std::cout << "USAGE: " << argv[0] << " <ringName> [output.pcap]\n";
+        return 1;
+    }
+
+    try {
+        ShmRingReader reader(argv[1]);
+
+        std::ofstream outpFile;
+        if (argc == 3) {
+            outpFile.open(argv[2], std::fstream::out | std::fstream::binary);
+            if (!outpFile.is_open()) {
+                std::cerr << "cannot open " << argv[2] << "\n";
+                return 1;
+            }
+            const PcapGlobalHdr& globalHdr = reader.globalHdr();
+            outpFile.write((const char*)&globalHdr, sizeof(globalHdr));
+        }
+
+        PcapPacketHdr pcapHdr;
+        std::vector<uint8_t> data;
+        uint64_t packetNum = 0, overrunNum = 0;
+        ShmRingReader::Status status;
+
+        while (true) {
+            status = reader.next(pcapHdr, data);
+
+            if (status == ShmRingReader::Status::Packet) {
+                packetNum++;
+                if (outpFile.is_open()) {
+                    outpFile.write((const char*)&pcapHdr, sizeof(pcapHdr));
+                    outpFile.write((const char*)data.data(), data.size());
+                }
+            } else if (status == ShmRingReader::Status::Overrun) {
+                overrunNum++;
+            } else if (status == ShmRingReader::Status::Empty) {
+                timespec ts = { 0, 100000 }; // Wait 100 us for new packets
+                nanosleep(&ts, nullptr);
+            } else {
+                break;
+            }
+        }
+
+        std::cout << "packets: " << packetNum << ", overruns: " << overrunNum
+                  << ", lost bytes: " << reader.lostBytes() << "\n";
+        if (status == ShmRingReader::Status::Aborted) {
+            std::cerr << "ddist terminated before finishing the ring\n";
+            return 1;
+        }
+    } catch (const std::exception& e) {
+        std::cerr << e.what() << "\n";
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,77 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+/// Kind of the handler outputs a checkpoint was taken with.
+enum class OutputKind : uint32_t {
+    File, ///< PCAP files, optionally rotated.
+    Shm,  ///< Shared-memory rings.
+    Udp,  ///< UDP datagrams.
+    Unix  ///< Unix datagram sockets.
+};
+
+/**
+ * @brief Saved progress of a single handler.
+ *
+ * @details Holds the position in the handler's output at the
+ *          moment of the checkpoint and an opaque blob with
+ *          the handler-specific state (e.g. packet counters).
+ */
+struct HandlerCheckpoint {
+    uint32_t outputSegment = 0; ///< Index of the current output segment.
+    uint64_t outputOffset = 0;  ///< Number of bytes written to the current segment.
+    std::string state;          ///< Serialized handler state.
+};
+
+/**
+ * @brief Consistent snapshot of a distribution run.
+ *
+ * @details Taken after all handler queues have been drained,
+ *          so every packet before `inputOffset` is already
+ *          reflected in the handler outputs and state. The
+ *          output settings are stored as well, because the
+ *          handler positions are only meaningful for the same
+ *          kind of output and rotation.
+ */
+struct Checkpoint {
+    uint64_t inputSize = 0;   ///< Size of the input file, used to detect a different capture.
+    uint64_t inputOffset = 0; ///< Offset of the first packet not yet distributed.
+    OutputKind outputKind = OutputKind::File; ///< Outputs the handler positions refer to.
+    uint64_t rotateBytes = 0;   ///< Segment size limit of file outputs.
+    uint32_t rotateSeconds = 0; ///< Segment capture-time length of file outputs.
+    std::string readerState;  ///< Serialized pcapng section state at `inputOffset`, empty for classic PCAP.
+    std::vector<HandlerCheckpoint> handlers; ///< Per-handler progress.
+    std::string dedupState;   ///< Serialized duplicate filter, empty if deduplication is off.
+};
+
+/**
+ * @brief Atomically writes a checkpoint to disk.
+ *
+ * @param path Path to the checkpoint file.
+ * @param checkpoint The checkpoint to save.
+ * @return True on success.
+ *
+ * @details The checkpoint is written to a temporary file which
+ *          then replaces `path`, so a crash during the write
+ *          leaves the previous checkpoint intact.
+ */
+bool writeCheckpoint(const std::string& path, const Checkpoint& checkpoint);
+
+/**
+ * @brief Reads a checkpoint from disk.
+ *
+ * @param path Path to the checkpoint file.
+ * @param checkpoint Receives the loaded checkpoint.
+ * @return True if the file exists and is well-formed.
+ */
+bool readCheckpoint(const std::string& path, Checkpoint& checkpoint);
+
+/**
+ * @brief Flushes the contents of a file to the storage device.
+ *
+ * @param path Path to the file.
+ * @return True on success.
+ */
+bool syncFile(const std::string& path);
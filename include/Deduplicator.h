@@ -0,0 +1,86 @@
+#pragma once
+
+#include <cstdint>
+#include <iosfwd>
+#include <vector>
+#include "pcap_structs.h"
+
+/**
+ * @class Deduplicator
+ * @brief Detects duplicate packets within a time window.
+ *
+ * @details Packets are identified by a hash of their bytes with
+ *          the Ethernet header, IP TTL and header checksum left
+ *          out, so copies of a frame seen on different hops
+ *          still match.
+ *          Hashes are kept in a cuckoo filter of fixed size:
+ *          every slot holds a 32-bit fingerprint and the
+ *          capture time of the packet. Slots older than the
+ *          window are treated as free, so memory usage does
+ *          not depend on the length of the capture.
+ */
+class Deduplicator {
+public:
+    /**
+     * @brief Constructs a Deduplicator instance.
+     *
+     * @param globalHdr Global header of the capture, used for 
+     *                  the timestamp resolution.
+     * @param windowMs Time window in milliseconds of capture
+     *                 time within which a repeated packet is
+     *                 considered a duplicate.
+     * @param memoryBytes Memory budget for the filter.
+     */
+    Deduplicator(const PcapGlobalHdr&, uint32_t, size_t);
+
+    /**
+     * @brief Checks a packet and remembers it.
+     *
+     * @param packet The packet to check.
+     * @return True if the same packet was seen within the
+     *         window and should be dropped.
+     */
+    bool isDuplicate(const PcapPacket&);
+
+    /// Returns the number of checked packets.
+    uint64_t packetNum() const { return m_packetNum; }
+    /// Returns the number of detected duplicates.
+    uint64_t duplicateNum() const { return m_duplicateNum; }
+
+    /**
+     * @brief Saves the filter contents and counters.
+     *
+     * @param os Stream to write the state to.
+     */
+    void saveState(std::ostream&) const;
+
+    /**
+     * @brief Restores the filter contents and counters.
+     *
+     * @details The state is ignored if it was saved by a filter
+     *          of a different size.
+     *
+     * @param is Stream to read the state from.
+     */
+    void loadState(std::istream&);
+
+private:
+    static const size_t SLOTS_PER_BUCKET = 4; ///< Number of fingerprints per bucket.
+    static const size_t MAX_KICKS = 500;      ///< Relocation attempts before an entry is dropped.
+
+    std::vector<uint32_t> m_fingerprints; ///< Fingerprints, 0 marks an empty slot.
+    std::vector<uint32_t> m_times;        ///< Capture time of each slot, in milliseconds.
+    size_t m_bucketMask;                  ///< Number of buckets minus one.
+    uint32_t m_windowMs;                  ///< Duplicate detection window.
+    uint32_t m_tsUnitsPerMs;              ///< Timestamp fraction units per millisecond.
+    uint32_t m_rng = 0x9E3779B9;          ///< State of the generator choosing relocated slots.
+    uint64_t m_packetNum = 0;             ///< Number of checked packets.
+    uint64_t m_duplicateNum = 0;          ///< Number of detected duplicates.
+
+    /// Returns the alternate bucket for a fingerprint.
+    size_t altBucket(size_t, uint32_t) const;
+    /// Returns true if the slot is empty or outside the window.
+    bool isFree(size_t, uint32_t) const;
+    /// Stores a fingerprint, relocating others if needed.
+    void insert(size_t, size_t, uint32_t, uint32_t);
+};
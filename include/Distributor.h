@@ -6,6 +6,8 @@
 #include <queue>
 #include <atomic>
 #include "pcap_structs.h"
+#include "Checkpoint.h"
+#include "Output.h"
 
 class IHandler;
 
@@ -25,9 +27,13 @@ public:
      * @param globalHdr The global PCAP header for output 
      *                  files.
      * @param fileDir The directory containing the input file.
+     * @param outputOptions Where the handlers write packets.
+     * @param resume Checkpoint to resume the handlers from, or
+     *               nullptr to start from scratch.
      */
      
-    Distributor(PcapGlobalHdr, std::string);
+    Distributor(PcapGlobalHdr, std::string, const OutputOptions&, 
+                const Checkpoint* = nullptr);
     /**
      * @brief Destructor for the Distributor.
      *
@@ -56,6 +62,20 @@ public:
      */
     void stop();
     
+    /**
+     * @brief Takes a consistent snapshot of the handlers.
+     *
+     * @details Waits until every handler has processed all 
+     *          queued packets, then collects the output offsets 
+     *          and handler states. Must be called from the 
+     *          thread that calls distrPacket().
+     *
+     * @param checkpoint Receives the `handlers` part.
+     * @return False if an output could not be made durable; 
+     *         the checkpoint must not be saved then.
+     */
+    bool checkpoint(Checkpoint&);
+    
 private:
     IHandler* m_handlers[3]; ///< Array of handler objects.
     pthread_t m_threads[3];  ///< Array of threads for handlers.
@@ -64,5 +84,6 @@ private:
     std::condition_variable m_handler1_cv, m_handler2_cv, m_handler3_cv; ///< Condition variables for synchronization.
     std::queue<PcapPacket> m_handler1_queue, m_handler2_queue, m_handler3_queue; ///< Queues for packet transmission.
     std::atomic<bool> m_stopFlag; ////< Flag to signal handlers that no new packets will arrive.
+    PaceOrigin m_paceOrigin;      ///< Time base of paced socket outputs.
 };
 
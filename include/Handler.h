@@ -5,7 +5,11 @@
 #include <condition_variable>
 #include <queue>
 #include <atomic>
+#include <iosfwd>
+#include <memory>
 #include "pcap_structs.h"
+#include "Checkpoint.h"
+#include "Output.h"
 
 /**
  * @class IHandler
@@ -18,15 +22,24 @@
  */
 class IHandler {
 protected:
-    std::ofstream m_outpFile; ///< Output File stream for writing processed packets.
+    std::unique_ptr<IOutput> m_output; ///< Sink for writing processed packets.
     std::mutex& m_mtx; ///< Mutex for synchronizing access to the queue.
     std::condition_variable& m_cv; ///< Condition variable for signaling new packets.
     std::queue<PcapPacket>& m_pcktQueue; ///< Queue holding packets for processing.
     std::atomic<bool>& m_stopFlag; ///< Atomic flag to signal handler termination.
+    std::condition_variable m_idleCv; ///< Condition variable for signaling that the handler is idle.
+    bool m_busy = false; ///< True while a packet taken from the queue is being handled.
     
     /// @brief Processing loop for handling packets. 
     virtual void process();
     
+    /**
+     * @brief Writes a packet record to the output.
+     *
+     * @param packet The packet to be written.
+     */
+    void writePacket(const PcapPacket&);
+    
     /**
      * @brief Processes an individual packet.
      *
@@ -42,20 +55,52 @@ public:
      * @param cv Reference to a condition variable for thread signaling.
      * @param pcktQueue Reference to the queue containing packets.
      * @param stopFlag Reference to an atomic flag for stopping execution.
-     * @param globalHdr Global header for the output file.
-     * @param filePath The path to file, that should be open by handler.
+     * @param output Output for processed packets, owned by the handler.
      */
     IHandler(std::mutex&, 
              std::condition_variable&,
              std::queue<PcapPacket>&,
              std::atomic<bool>&,
-             PcapGlobalHdr,
-             std::string&);
+             std::unique_ptr<IOutput>);
     /**
      * @brief Virtual destructor to ensure proper cleanup.
      */
     virtual ~IHandler();
     
+    /**
+     * @brief Blocks until the queue is empty and no packet is 
+     *        being handled.
+     *
+     * @details The caller must not push new packets to the 
+     *          queue while waiting.
+     */
+    void waitIdle();
+    
+    /**
+     * @brief Captures the handler progress for a checkpoint.
+     *
+     * @details Makes the output durable. Must only be called 
+     *          while the handler is idle.
+     *
+     * @param checkpoint Receives the handler checkpoint.
+     * @return False if the output could not be made durable.
+     */
+    bool checkpoint(HandlerCheckpoint&);
+    
+    /**
+     * @brief Saves the handler-specific state.
+     *
+     * @param os Stream to write the state to.
+     */
+    virtual void saveState(std::ostream&) const {}
+    
+    /**
+     * @brief Restores the handler-specific state.
+     *
+     * @param is Stream to read the state from.
+     */
+    virtual void loadState(std::istream&) {}
+    
     /**
      * @brief Entry point for handler threads.
      *
@@ -77,6 +122,12 @@ class Handler1 : public IHandler {
 private:
     size_t m_packetNum = 0; ///< Counter for processed packets.
     
+public:
+    /// Saves the packet counter.
+    void saveState(std::ostream&) const override;
+    /// Restores the packet counter.
+    void loadState(std::istream&) override;
+    
 protected:
     /**
      * @brief Handles a specific packet.
@@ -0,0 +1,244 @@
+#pragma once
+
+#include <chrono>
+#include <fstream>
+#include <future>
+#include <string>
+#include <vector>
+#include <sys/socket.h>
+#include "pcap_structs.h"
+#include "Checkpoint.h"
+
+struct ShmRingHdr;
+
+/**
+ * @brief Output settings shared by all handlers.
+ */
+struct OutputOptions {
+    std::string shmName;          ///< Name prefix of shared-memory rings, empty to write files.
+    size_t shmSize = 64 << 20;    ///< Size of the data area of each ring in bytes.
+    uint64_t rotateBytes = 0;     ///< Maximum size of an output segment, 0 for no limit.
+    uint32_t rotateSeconds = 0;   ///< Capture-time length of an output segment, 0 for no limit.
+    std::string udpIp;            ///< IPv4 address of the UDP destination, empty if not used.
+    uint16_t udpPort = 0;         ///< UDP port of the first handler, the others use the next ports.
+    std::string unixPath;         ///< Path prefix of Unix datagram sockets, empty if not used.
+    size_t sendBatch = 32;        ///< Number of packets sent with one sendmmsg() call.
+    double paceSpeed = 0;         ///< Replay speed relative to capture time, 0 sends at full rate.
+
+    /// Returns the kind of output selected by these options.
+    OutputKind kind() const {
+        return !udpIp.empty() ? OutputKind::Udp :
+               !unixPath.empty() ? OutputKind::Unix :
+               !shmName.empty() ? OutputKind::Shm : OutputKind::File;
+    }
+};
+
+/**
+ * @class IOutput
+ * @brief Abstract sink for packets written by a handler.
+ */
+class IOutput {
+public:
+    /// Virtual destructor to ensure proper cleanup.
+    virtual ~IOutput() = default;
+
+    /**
+     * @brief Writes a packet record.
+     *
+     * @param pcapHdr PCAP header of the packet.
+     * @param data The first `pcapHdr.inclLen` bytes of the packet.
+     */
+    virtual void write(const PcapPacketHdr&, const uint8_t*) = 0;
+
+    /**
+     * @brief Makes the written packets durable for a checkpoint.
+     *
+     * @param checkpoint Receives the position to resume the 
+     *                   output from.
+     * @return False if the packets could not be made durable.
+     */
+    virtual bool checkpoint(HandlerCheckpoint&) { return true; }
+
+    /// Called when the handler has no more queued packets.
+    virtual void idle() {}
+};
+
+/**
+ * @class FileOutput
+ * @brief Writes packets to a PCAP file.
+ *
+ * @details If rotation is enabled, the output is split into 
+ *          segments `<name>_NNNNNN.pcap`, each starting with the 
+ *          global header. A new segment is started when the 
+ *          current one would exceed `rotateBytes` or when a 
+ *          packet falls into the next `rotateSeconds` interval 
+ *          of capture time. The next segment is created and 
+ *          preallocated in the background while the current 
+ *          one is written, so switching does not wait for the 
+ *          file system.
+ */
+class FileOutput : public IOutput {
+public:
+    /**
+     * @brief Opens the output file.
+     *
+     * @param globalHdr Global header for the output file.
+     * @param filePath Path to the output file.
+     * @param options Rotation settings.
+     * @param resume Checkpoint to resume the file from, or
+     *               nullptr to create a new file.
+     */
+    FileOutput(PcapGlobalHdr, const std::string&, const OutputOptions&,
+               const HandlerCheckpoint* = nullptr);
+    /// Closes the output file.
+    ~FileOutput() override;
+
+    void write(const PcapPacketHdr&, const uint8_t*) override;
+    /// Flushes the closed segments and the file to disk and stores its segment and size.
+    bool checkpoint(HandlerCheckpoint&) override;
+
+private:
+    std::ofstream m_outpFile;    ///< Output File stream for writing processed packets.
+    std::string m_filePath;      ///< Path to the output file, or the name template if rotating.
+    PcapGlobalHdr m_globalHdr;   ///< Global header written at the start of every segment.
+    uint64_t m_rotateBytes;      ///< Maximum segment size, 0 for no limit.
+    uint32_t m_rotateSeconds;    ///< Segment capture-time length, 0 for no limit.
+    uint32_t m_segment = 0;      ///< Index of the current segment.
+    uint64_t m_written = 0;      ///< Bytes written to the current segment.
+    uint64_t m_slot = 0;         ///< Capture-time interval of the current segment.
+    bool m_slotSet = false;      ///< True once `m_slot` holds the interval of the current segment.
+    bool m_hasPacket = false;    ///< True once the current segment has a packet.
+    std::future<std::ofstream> m_next; ///< Next segment being prepared in the background.
+    std::vector<uint32_t> m_unsynced;  ///< Closed segments not yet flushed to disk.
+
+    /// Returns true if the output is split into segments.
+    bool rotating() const { return m_rotateBytes || m_rotateSeconds; }
+    /// Returns the path of a segment.
+    std::string segmentPath(uint32_t) const;
+    /// Starts preparing the segment after the current one.
+    void prepareNext(uint64_t);
+    /// Closes the current segment and switches to the next one.
+    void rotate();
+    /// Truncates the current segment to the written size and closes it.
+    void closeSegment();
+};
+
+/**
+ * @class ShmRingOutput
+ * @brief Publishes packets into a shared-memory ring.
+ *
+ * @details The ring is read by ShmRingReader. The writer never
+ *          waits for readers; slow readers are overrun instead.
+ *          The segment is left in place after the run so
+ *          readers can drain it, and replaced on the next run.
+ */
+class ShmRingOutput : public IOutput {
+public:
+    /**
+     * @brief Creates the shared-memory ring.
+     *
+     * @param globalHdr Global header of the capture.
+     * @param name Name of the POSIX shared-memory object.
+     * @param capacity Size of the data area, rounded up to a
+     *                 power of two.
+     */
+    ShmRingOutput(PcapGlobalHdr, const std::string&, size_t);
+    /// Marks the ring as closed and unmaps it.
+    ~ShmRingOutput() override;
+
+    void write(const PcapPacketHdr&, const uint8_t*) override;
+
+private:
+    ShmRingHdr* m_hdr = nullptr; ///< Mapped ring header.
+    uint8_t* m_data = nullptr;   ///< Mapped data area.
+    size_t m_mapSize = 0;        ///< Size of the mapping.
+    uint64_t m_mask = 0;         ///< Capacity minus one.
+    uint64_t m_writePos = 0;     ///< Local copy of the published position.
+    uint64_t m_tail = 0;         ///< Local copy of the oldest intact record position.
+
+    /// Drops the oldest records until `end` fits into the ring.
+    void reserve(uint64_t);
+};
+
+/**
+ * @brief Time base of paced sending, shared by the outputs of all
+ *        handlers.
+ *
+ * @details Fixed by the Distributor from the first distributed
+ *          packet before that packet is queued, so the handlers
+ *          only read it and keep the relative timing of the
+ *          capture across outputs.
+ */
+struct PaceOrigin {
+    bool started = false;   ///< True once the first packet was distributed.
+    uint32_t tsSec = 0;     ///< Capture time of the first packet, seconds.
+    uint32_t tsFrac = 0;    ///< Capture time of the first packet, fraction units.
+    std::chrono::steady_clock::time_point startTime; ///< Time the first packet was distributed.
+};
+
+/**
+ * @class SocketOutput
+ * @brief Sends packets as datagrams over a local socket.
+ *
+ * @details Every datagram holds one PCAP record: the 
+ *          PcapPacketHdr followed by the packet bytes. Records 
+ *          are collected into batches and sent with a single 
+ *          sendmmsg() call. With pacing, each record is sent 
+ *          when its capture time relative to the first 
+ *          distributed packet, scaled by the speed factor, is 
+ *          reached.
+ */
+class SocketOutput : public IOutput {
+public:
+    /**
+     * @brief Creates a UDP socket.
+     *
+     * @param globalHdr Global header of the capture.
+     * @param ip IPv4 address of the destination.
+     * @param port UDP port of the destination.
+     * @param batch Maximum number of records per sendmmsg().
+     * @param paceSpeed Replay speed, 0 to send at full rate.
+     * @param paceOrigin Time base shared with the other outputs.
+     */
+    SocketOutput(PcapGlobalHdr, const std::string&, uint16_t, size_t, double,
+                 const PaceOrigin&);
+    /**
+     * @brief Creates a Unix datagram socket.
+     *
+     * @param globalHdr Global header of the capture.
+     * @param path Path of the destination socket.
+     * @param batch Maximum number of records per sendmmsg().
+     * @param paceSpeed Replay speed, 0 to send at full rate.
+     * @param paceOrigin Time base shared with the other outputs.
+     */
+    SocketOutput(PcapGlobalHdr, const std::string&, size_t, double,
+                 const PaceOrigin&);
+    /// Sends the pending records and closes the socket.
+    ~SocketOutput() override;
+
+    void write(const PcapPacketHdr&, const uint8_t*) override;
+    /// Sends the pending records.
+    bool checkpoint(HandlerCheckpoint&) override;
+    /// Sends the pending records when pacing, as they are already due.
+    void idle() override;
+
+private:
+    using Clock = std::chrono::steady_clock;
+
+    int m_sock = -1;                         ///< Socket descriptor.
+    sockaddr_storage m_addr;                 ///< Destination address.
+    socklen_t m_addrLen;                     ///< Length of the destination address.
+    std::vector<std::vector<uint8_t>> m_records; ///< Buffers of the pending records.
+    std::vector<iovec> m_iovs;               ///< Scatter entries, one per record.
+    std::vector<mmsghdr> m_msgs;             ///< Message headers for sendmmsg().
+    size_t m_pending = 0;                    ///< Number of pending records.
+    double m_paceSpeed;                      ///< Replay speed, 0 if pacing is off.
+    double m_tsUnitsPerSec;                  ///< Timestamp fraction units per second.
+    const PaceOrigin& m_paceOrigin;          ///< Time base shared by all handlers.
+    uint64_t m_droppedNum = 0;               ///< Records the kernel refused to send.
+
+    /// Creates the socket and the record buffers.
+    void init(int, const std::string&, size_t);
+    /// Sends all pending records.
+    void flush();
+};
@@ -0,0 +1,130 @@
+#pragma once
+
+#include <fstream>
+#include <iosfwd>
+#include <vector>
+#include "pcap_structs.h"
+
+/**
+ * @class PcapReader
+ * @brief Reads packets from classic PCAP and pcapng files.
+ *
+ * @details Supports classic PCAP with microsecond and
+ *          nanosecond timestamps in either byte order, and
+ *          pcapng with Enhanced, Simple and obsolete Packet
+ *          Blocks from any number of interfaces. The byte order
+ *          is detected from the file (for pcapng, from each
+ *          Section Header Block) and selects a parse routine
+ *          specialized for it, so fields are not checked
+ *          individually.
+ *
+ *          Packets are returned with classic PCAP headers in
+ *          host byte order. Their timestamps keep the input
+ *          resolution: nanosecond classic files stay nanosecond,
+ *          and pcapng files use nanoseconds if the first
+ *          interface has a resolution finer than microseconds.
+ */
+class PcapReader {
+public:
+    /**
+     * @brief Reads the file header and detects the format.
+     *
+     * @details Terminates the program if the file is neither
+     *          classic PCAP nor pcapng.
+     *
+     * @param pcapFs Input file stream positioned at the start.
+     */
+    explicit PcapReader(std::ifstream&);
+
+    /// Returns the global header for the output files.
+    const PcapGlobalHdr& globalHdr() const { return m_globalHdr; }
+
+    /**
+     * @brief Reads the next packet.
+     *
+     * @param packet Receives the PCAP header and data.
+     * @return False at the end of the file.
+     */
+    bool next(PcapPacket& packet) { return (this->*m_readNext)(packet); }
+
+    /// Returns the offset of the next record, for checkpoints.
+    uint64_t offset() const { return m_offset; }
+
+    /**
+     * @brief Continues reading from an offset returned by
+     *        offset().
+     *
+     * @details For pcapng the section state saved with the
+     *          offset must be restored with loadState() first.
+     *
+     * @param offset Offset of the next record.
+     */
+    void seek(uint64_t);
+
+    /**
+     * @brief Saves the pcapng section state for a checkpoint.
+     *
+     * @details Stores the byte order, the offset of the current
+     *          Section Header Block and its interfaces. Nothing
+     *          is saved for classic PCAP files.
+     *
+     * @param os Stream to write the state to.
+     */
+    void saveState(std::ostream&) const;
+
+    /**
+     * @brief Restores the state saved by saveState().
+     *
+     * @param is Stream to read the state from.
+     * @return False if the state does not belong to this file.
+     */
+    bool loadState(std::istream&);
+
+private:
+    /// Settings of a pcapng interface.
+    struct Interface {
+        uint16_t linkType = 0;       ///< Link-layer type.
+        uint32_t snapLen = 0;        ///< Maximum captured length.
+        uint64_t unitsPerSec = 1000000; ///< Timestamp units per second (if_tsresol).
+        int64_t tsOffset = 0;        ///< Seconds added to timestamps (if_tsoffset).
+    };
+
+    std::ifstream& m_fs;          ///< Input file stream.
+    PcapGlobalHdr m_globalHdr;    ///< Global header for the output files.
+    uint32_t m_outUnitsPerSec;    ///< Timestamp fraction units per second of the output.
+    std::vector<Interface> m_interfaces; ///< Interfaces of the current pcapng section.
+    std::vector<uint8_t> m_block; ///< Body of the current pcapng block, including the trailing length.
+    uint64_t m_offset = 0;        ///< File offset of the next record or block.
+    uint64_t m_sectionOffset = 0; ///< File offset of the current pcapng Section Header Block.
+    bool m_isNg = false;          ///< True for pcapng files.
+    bool m_swap = false;          ///< True if the current pcapng section has the other byte order.
+    bool (PcapReader::*m_readNext)(PcapPacket&); ///< Parse routine for the current byte order.
+
+    /// Reads a classic PCAP record.
+    template <bool Swap> bool readClassic(PcapPacket&);
+    /// Reads pcapng blocks until a packet is found.
+    template <bool Swap> bool readNg(PcapPacket&);
+    /// Reads the next pcapng block, applying section and interface blocks.
+    template <bool Swap> bool readNgBlock(uint32_t&, bool);
+    /// Applies the settings of a pcapng Interface Description Block.
+    template <bool Swap> void parseIdb();
+    /// Fills a packet from the packet block in the buffer.
+    template <bool Swap> void parsePacketBlock(uint32_t, PcapPacket&);
+    /// Returns the size of the block body in the buffer without the trailing length.
+    size_t bodySize() const { return m_block.size() - 4; }
+    /// Reads a field of the block in the buffer.
+    template <bool Swap, typename T> T field(size_t) const;
+    /// Converts a pcapng timestamp to seconds and fraction.
+    void convertTs(const Interface&, uint64_t, PcapPacketHdr&) const;
+
+    /// Reads the next pcapng block without loading packet data.
+    bool scanNgBlock(uint32_t&);
+    /// Reads the rest of a pcapng Section Header Block and selects the byte order.
+    bool readShb(uint32_t);
+    /// Reads the header of a classic PCAP file.
+    void openClassic();
+    /// Reads pcapng blocks up to the first interface.
+    void openNg();
+    /// Reports a malformed file and terminates the program.
+    [[noreturn]] void formatError() const;
+};
@@ -0,0 +1,116 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "pcap_structs.h"
+
+/**
+ * @brief Header at the beginning of a shared-memory ring.
+ *
+ * @details The ring has a single writer and any number of
+ *          readers. Positions are byte counters that only grow;
+ *          the offset in the data area is `position &
+ *          (capacity - 1)`. Readers keep their own cursors and
+ *          never write to the segment, so they do not slow the
+ *          writer down. A reader that falls more than
+ *          `capacity` bytes behind is overrun and skips to the
+ *          oldest record still in the ring.
+ *
+ *          `closed` is only set when the writer finishes
+ *          normally. If it is killed, readers detect that the
+ *          process `writerPid` no longer exists.
+ */
+struct ShmRingHdr {
+    uint32_t magic;              ///< SHM_RING_MAGIC once the segment is initialized.
+    uint32_t version;            ///< Layout version, SHM_RING_VERSION.
+    uint64_t capacity;           ///< Size of the data area in bytes, a power of two.
+    int32_t writerPid;           ///< Process id of the writer, to detect that it died.
+    PcapGlobalHdr globalHdr;     ///< Global PCAP header of the distributed capture.
+    alignas(64) std::atomic<uint64_t> reservePos; ///< End of the record being written.
+    alignas(64) std::atomic<uint64_t> writePos;   ///< End of the last published record.
+    std::atomic<uint64_t> tailPos;                ///< Start of the oldest intact record.
+    std::atomic<uint32_t> closed;                 ///< Set when the writer has finished.
+};
+
+/**
+ * @brief Header of a record in the ring data area.
+ *
+ * @details A packet record is followed by the PcapPacketHdr and
+ *          the packet bytes, padded to SHM_RING_ALIGN. Records
+ *          never wrap around the end of the data area; the
+ *          space left at the end is covered by a padding record.
+ */
+struct ShmRecordHdr {
+    uint32_t size;  ///< Size of the whole record including this header.
+    uint32_t flags; ///< SHM_RECORD_PADDING for padding records.
+};
+
+const uint32_t SHM_RING_MAGIC = 0x52534444; // "DDSR"
+const uint32_t SHM_RING_VERSION = 2;
+const uint32_t SHM_RING_ALIGN = 8;
+const uint32_t SHM_RECORD_PADDING = 1;
+
+/// Offset of the data area from the start of the segment.
+const size_t SHM_RING_DATA_OFFSET = (sizeof(ShmRingHdr) + 63) / 64 * 64;
+
+/**
+ * @class ShmRingReader
+ * @brief Reads packets from a shared-memory ring.
+ *
+ * @details Attaches to a ring created by `ddist --shm` and
+ *          returns the published packets in order. Each reader
+ *          has its own cursor.
+ */
+class ShmRingReader {
+public:
+    /// Result of a read attempt.
+    enum class Status {
+        Packet,  ///< A packet was read.
+        Empty,   ///< No new packets yet.
+        Overrun, ///< The writer overwrote unread packets; reading continues from the oldest intact one.
+        Closed,  ///< The writer has finished and all packets were read.
+        Aborted  ///< The writer died without finishing and all published packets were read.
+    };
+
+    /**
+     * @brief Attaches to a shared-memory ring.
+     *
+     * @param name Name of the POSIX shared-memory object.
+     * @param fromOldest Start from the oldest packet in the ring
+     *                   instead of only new packets.
+     *
+     * @throws std::runtime_error if the ring cannot be opened.
+     */
+    explicit ShmRingReader(const std::string&, bool = true);
+    /// Detaches from the ring.
+    ~ShmRingReader();
+
+    ShmRingReader(const ShmRingReader&) = delete;
+    ShmRingReader& operator=(const ShmRingReader&) = delete;
+
+    /**
+     * @brief Reads the next packet without blocking.
+     *
+     * @param pcapHdr Receives the PCAP header of the packet.
+     * @param data Receives the packet bytes.
+     * @return Status of the read.
+     */
+    Status next(PcapPacketHdr&, std::vector<uint8_t>&);
+
+    /// Returns the global PCAP header of the capture.
+    const PcapGlobalHdr& globalHdr() const { return m_hdr->globalHdr; }
+    /// Returns the number of bytes lost to overruns.
+    uint64_t lostBytes() const { return m_lostBytes; }
+
+private:
+    ShmRingHdr* m_hdr = nullptr;    ///< Mapped ring header.
+    const uint8_t* m_data = nullptr; ///< Mapped data area.
+    size_t m_mapSize = 0;           ///< Size of the mapping.
+    uint64_t m_cursor = 0;          ///< Position of the next record to read.
+    uint64_t m_lostBytes = 0;       ///< Bytes skipped because of overruns.
+
+    /// Returns false if the writer process no longer exists.
+    bool writerAlive() const;
+};
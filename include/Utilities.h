@@ -36,3 +36,36 @@ uint16_t inline changeEndian(uint16_t value) {
     return (value << 8) | (value >> 8);
 }
 
+/**
+ * @brief Changes the endianness of a 64-bit value.
+ * 
+ * @param value The 64-bit value whose byte order is to be 
+ *              changed.
+ * @return The value with its byte order changed.
+ */
+inline uint64_t changeEndian(uint64_t value) {
+    return ((uint64_t)changeEndian((uint32_t)value) << 32) |
+           changeEndian((uint32_t)(value >> 32));
+}
+
+/**
+ * @brief Converts a value from the byte order of a file to the 
+ *        host byte order.
+ *
+ * @tparam Swap True if the file byte order differs from the 
+ *              host byte order.
+ * @param value The value as stored in the file.
+ * @return The value in host byte order.
+ *
+ * @details The byte order is a template parameter so that 
+ *          parse routines are instantiated once per byte order 
+ *          instead of checking it for every field.
+ */
+template <bool Swap, typename T>
+inline T fromFileOrder(T value) {
+    if constexpr (Swap) {
+        return changeEndian(value);
+    } else {
+        return value;
+    }
+}
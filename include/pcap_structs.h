@@ -20,6 +20,20 @@ struct PcapGlobalHdr {
     uint32_t network;        ///< Data link type (e.g., Ethernet, PPP, etc.).
 };
 
+const uint32_t PCAP_MAGIC_USEC = 0xA1B2C3D4; ///< Magic number of files with microsecond timestamps.
+const uint32_t PCAP_MAGIC_NSEC = 0xA1B23C4D; ///< Magic number of files with nanosecond timestamps.
+
+/**
+ * @brief Returns the number of timestamp fraction units per 
+ *        second.
+ *
+ * @param globalHdr Global header in host byte order.
+ * @return 1000000000 for nanosecond files, 1000000 otherwise.
+ */
+inline uint32_t pcapTsUnitsPerSec(const PcapGlobalHdr& globalHdr) {
+    return globalHdr.magicNumber == PCAP_MAGIC_NSEC ? 1000000000 : 1000000;
+}
+
 /**
  * @brief Packet header for each captured packet in a PCAP 
  *        file.
@@ -29,7 +43,7 @@ struct PcapGlobalHdr {
  */
 struct PcapPacketHdr {
     uint32_t tsSec;          ///< Timestamp seconds (seconds since epoch).
-    uint32_t tsUsec;         ///< Timestamp microseconds.
+    uint32_t tsUsec;         ///< Timestamp fraction, microseconds or nanoseconds depending on the magic number.
     uint32_t inclLen;        ///< Number of bytes captured from the packet.
     uint32_t origLen;        ///< Original length of the packet before truncation.
 };
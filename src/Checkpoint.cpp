@@ -0,0 +1,117 @@
+#include "Checkpoint.h"
+
+#include <fstream>
+#include <cstdio>
+#include <unistd.h>
+#include <fcntl.h>
+
+namespace {
+
+const uint32_t CHECKPOINT_MAGIC = 0x4B434444; // "DDCK"
+const uint32_t CHECKPOINT_VERSION = 3;
+
+template <typename T>
+void writeValue(std::ofstream& fs, const T& value) {
+    fs.write((const char*)&value, sizeof(value));
+}
+
+template <typename T>
+bool readValue(std::ifstream& fs, T& value) {
+    return (bool)fs.read((char*)&value, sizeof(value));
+}
+
+} // namespace
+
+bool syncFile(const std::string& path) {
+    int fd = open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+        return false;
+    }
+    bool ok = fsync(fd) == 0;
+    close(fd);
+    return ok;
+}
+
+/**
+ * File layout: magic, version, input size, input offset, output
+ * kind and rotation settings, the length-prefixed input reader
+ * state, number of handlers, for every handler its output segment
+ * and offset followed by the length-prefixed state blob, and
+ * finally the length-prefixed duplicate filter state.
+ */
+bool writeCheckpoint(const std::string& path, const Checkpoint& checkpoint) {
+    std::string tmpPath = path + ".tmp";
+    std::ofstream fs(tmpPath, std::fstream::out | std::fstream::binary | std::fstream::trunc);
+    if (!fs.is_open()) {
+        return false;
+    }
+
+    writeValue(fs, CHECKPOINT_MAGIC);
+    writeValue(fs, CHECKPOINT_VERSION);
+    writeValue(fs, checkpoint.inputSize);
+    writeValue(fs, checkpoint.inputOffset);
+    writeValue(fs, checkpoint.outputKind);
+    writeValue(fs, checkpoint.rotateBytes);
+    writeValue(fs, checkpoint.rotateSeconds);
+    writeValue(fs, (uint32_t)checkpoint.readerState.size());
+    fs.write(checkpoint.readerState.data(), checkpoint.readerState.size());
+    writeValue(fs, (uint32_t)checkpoint.handlers.size());
+
+    for (const HandlerCheckpoint& handler : checkpoint.handlers) {
+        writeValue(fs, handler.outputSegment);
+        writeValue(fs, handler.outputOffset);
+        writeValue(fs, (uint32_t)handler.state.size());
+        fs.write(handler.state.data(), handler.state.size());
+    }
+    writeValue(fs, (uint32_t)checkpoint.dedupState.size());
+    fs.write(checkpoint.dedupState.data(), checkpoint.dedupState.size());
+
+    fs.close();
+    if (fs.fail() || !syncFile(tmpPath)) {
+        return false;
+    }
+    return std::rename(tmpPath.c_str(), path.c_str()) == 0;
+}
+
+bool readCheckpoint(const std::string& path, Checkpoint& checkpoint) {
+    std::ifstream fs(path, std::fstream::in | std::fstream::binary);
+    if (!fs.is_open()) {
+        return false;
+    }
+
+    uint32_t magic, version, readerLen, handlerNum;
+    if (!readValue(fs, magic) || magic != CHECKPOINT_MAGIC ||
+        !readValue(fs, version) || version != CHECKPOINT_VERSION ||
+        !readValue(fs, checkpoint.inputSize) ||
+        !readValue(fs, checkpoint.inputOffset) ||
+        !readValue(fs, checkpoint.outputKind) ||
+        !readValue(fs, checkpoint.rotateBytes) ||
+        !readValue(fs, checkpoint.rotateSeconds) ||
+        !readValue(fs, readerLen)) {
+        return false;
+    }
+    checkpoint.readerState.resize(readerLen);
+    if (!fs.read(&checkpoint.readerState[0], readerLen) || !readValue(fs, handlerNum)) {
+        return false;
+    }
+
+    checkpoint.handlers.resize(handlerNum);
+    for (HandlerCheckpoint& handler : checkpoint.handlers) {
+        uint32_t stateLen;
+        if (!readValue(fs, handler.outputSegment) || 
+            !readValue(fs, handler.outputOffset) || !readValue(fs, stateLen)) {
+            return false;
+        }
+        handler.state.resize(stateLen);
+        if (!fs.read(&handler.state[0], stateLen)) {
+            return false;
+        }
+    }
+
+    uint32_t dedupLen;
+    if (!readValue(fs, dedupLen)) {
+        return false;
+    }
+    checkpoint.dedupState.resize(dedupLen);
+    return (bool)fs.read(&checkpoint.dedupState[0], dedupLen);
+}
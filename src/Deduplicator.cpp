@@ -0,0 +1,175 @@
+#include "Deduplicator.h"
+
+#include <algorithm>
+#include <istream>
+#include <ostream>
+
+namespace {
+
+const size_t IP_TTL_OFFSET = 8;       ///< Offset of the TTL field in the IP header.
+const size_t IP_CHECKSUM_OFFSET = 10; ///< Offset of the header checksum in the IP header.
+
+/// FNV-1a over a byte range.
+uint64_t hashBytes(uint64_t hash, const uint8_t* begin, const uint8_t* end) {
+    for (const uint8_t* p = begin; p < end; p++) {
+        hash ^= *p;
+        hash *= 0x100000001B3ULL;
+    }
+    return hash;
+}
+
+/**
+ * Hashes the captured bytes of the packet from the IP header on, except
+ * for the TTL and the header checksum. The Ethernet header, TTL and
+ * checksum change on every hop.
+ */
+uint64_t hashPacket(const PcapPacket& packet) {
+    size_t frameLen = std::min<size_t>(packet.pcapHdr.inclLen, packet.data.size());
+    size_t ethLen = std::min(frameLen, sizeof(EthHdr));
+    const uint8_t* data = packet.data.data() + ethLen;
+    size_t len = frameLen - ethLen;
+    uint64_t hash = 0xCBF29CE484222325ULL;
+
+    hash = hashBytes(hash, (const uint8_t*)&packet.pcapHdr.origLen,
+                     (const uint8_t*)&packet.pcapHdr.origLen + sizeof(packet.pcapHdr.origLen));
+    hash = hashBytes(hash, data, data + std::min(len, IP_TTL_OFFSET));
+    if (len > IP_TTL_OFFSET + 1) {
+        hash = hashBytes(hash, data + IP_TTL_OFFSET + 1, data + std::min(len, IP_CHECKSUM_OFFSET));
+    }
+    if (len > IP_CHECKSUM_OFFSET + 2) {
+        hash = hashBytes(hash, data + IP_CHECKSUM_OFFSET + 2, data + len);
+    }
+
+    // Final mix so that the bucket index and fingerprint are independent
+    hash ^= hash >> 33;
+    hash *= 0xFF51AFD7ED558CCDULL;
+    hash ^= hash >> 33;
+    return hash;
+}
+
+} // namespace
+
+Deduplicator::Deduplicator(const PcapGlobalHdr& globalHdr, uint32_t windowMs, 
+                           size_t memoryBytes)
+    : m_windowMs(windowMs), 
+    m_tsUnitsPerMs(pcapTsUnitsPerSec(globalHdr) / 1000) {
+    size_t slotSize = sizeof(uint32_t) * 2;
+    size_t bucketNum = 1;
+    while (bucketNum * 2 * SLOTS_PER_BUCKET * slotSize <= memoryBytes) {
+        bucketNum *= 2;
+    }
+
+    m_bucketMask = bucketNum - 1;
+    m_fingerprints.assign(bucketNum * SLOTS_PER_BUCKET, 0);
+    m_times.assign(bucketNum * SLOTS_PER_BUCKET, 0);
+}
+
+/**
+ * The packet is looked up in both of its candidate buckets. A matching
+ * fingerprint counts only if it was stored within the window, so the
+ * window is measured from the first copy of the packet.
+ */
+bool Deduplicator::isDuplicate(const PcapPacket& packet) {
+    m_packetNum++;
+
+    uint64_t hash = hashPacket(packet);
+    uint32_t fingerprint = (uint32_t)(hash >> 32);
+    if (fingerprint == 0) {
+        fingerprint = 1;
+    }
+    uint32_t now = packet.pcapHdr.tsSec * 1000 + packet.pcapHdr.tsUsec / m_tsUnitsPerMs;
+
+    size_t bucket1 = hash & m_bucketMask;
+    size_t bucket2 = altBucket(bucket1, fingerprint);
+
+    for (size_t bucket : {bucket1, bucket2}) {
+        for (size_t i = 0; i < SLOTS_PER_BUCKET; i++) {
+            size_t slot = bucket * SLOTS_PER_BUCKET + i;
+            if (m_fingerprints[slot] == fingerprint && !isFree(slot, now)) {
+                m_duplicateNum++;
+                return true;
+            }
+        }
+    }
+
+    insert(bucket1, bucket2, fingerprint, now);
+    return false;
+}
+
+size_t Deduplicator::altBucket(size_t bucket, uint32_t fingerprint) const {
+    return (bucket ^ (fingerprint * 0x5BD1E995U)) & m_bucketMask;
+}
+
+/**
+ * Copies merged from several capture points may arrive slightly out of
+ * order, so the distance to the stored time is taken in both directions.
+ */
+bool Deduplicator::isFree(size_t slot, uint32_t now) const {
+    uint32_t distance = now - m_times[slot];
+    if ((int32_t)distance < 0) {
+        distance = 0 - distance;
+    }
+    return m_fingerprints[slot] == 0 || distance > m_windowMs;
+}
+
+/**
+ * If both buckets are full, a random entry is moved to its alternate
+ * bucket, repeating up to MAX_KICKS times. When the table is saturated
+ * the last displaced entry is lost, which can only cause a missed
+ * duplicate, never a false one.
+ */
+void Deduplicator::insert(size_t bucket1, size_t bucket2,
+                          uint32_t fingerprint, uint32_t now) {
+    for (size_t bucket : {bucket1, bucket2}) {
+        for (size_t i = 0; i < SLOTS_PER_BUCKET; i++) {
+            size_t slot = bucket * SLOTS_PER_BUCKET + i;
+            if (isFree(slot, now)) {
+                m_fingerprints[slot] = fingerprint;
+                m_times[slot] = now;
+                return;
+            }
+        }
+    }
+
+    uint32_t time = now;
+    size_t bucket = (m_rng & 1) ? bucket1 : bucket2;
+    for (size_t kick = 0; kick < MAX_KICKS; kick++) {
+        m_rng ^= m_rng << 13;
+        m_rng ^= m_rng >> 17;
+        m_rng ^= m_rng << 5;
+
+        size_t slot = bucket * SLOTS_PER_BUCKET + m_rng % SLOTS_PER_BUCKET;
+        std::swap(fingerprint, m_fingerprints[slot]);
+        std::swap(time, m_times[slot]);
+
+        bucket = altBucket(bucket, fingerprint);
+        for (size_t i = 0; i < SLOTS_PER_BUCKET; i++) {
+            slot = bucket * SLOTS_PER_BUCKET + i;
+            if (isFree(slot, now)) {
+                m_fingerprints[slot] = fingerprint;
+                m_times[slot] = time;
+                return;
+            }
+        }
+    }
+}
+
+void Deduplicator::saveState(std::ostream& os) const {
+    uint64_t bucketMask = m_bucketMask;
+    os.write((const char*)&bucketMask, sizeof(bucketMask));
+    os.write((const char*)&m_packetNum, sizeof(m_packetNum));
+    os.write((const char*)&m_duplicateNum, sizeof(m_duplicateNum));
+    os.write((const char*)m_fingerprints.data(), m_fingerprints.size() * sizeof(uint32_t));
+    os.write((const char*)m_times.data(), m_times.size() * sizeof(uint32_t));
+}
+
+void Deduplicator::loadState(std::istream& is) {
+    uint64_t bucketMask = 0;
+    if (!is.read((char*)&bucketMask, sizeof(bucketMask)) || bucketMask != m_bucketMask) {
+        return;
+    }
+    is.read((char*)&m_packetNum, sizeof(m_packetNum));
+    is.read((char*)&m_duplicateNum, sizeof(m_duplicateNum));
+    is.read((char*)m_fingerprints.data(), m_fingerprints.size() * sizeof(uint32_t));
+    is.read((char*)m_times.data(), m_times.size() * sizeof(uint32_t));
+}
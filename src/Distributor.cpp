@@ -3,23 +3,56 @@
 #include "Utilities.h"
 
 #include <iostream>
+#include <sstream>
 #include <pthread.h>
 
-Distributor::Distributor(PcapGlobalHdr globalHdr, std::string fileDir)
+/**
+ * Each handler writes to `result_N.pcap` in the input file directory,
+ * or, if configured, sends to UDP port `<port> + N - 1`, to the Unix 
+ * socket `<unixPath>_N` or to the shared-memory ring `<shmName>_N`.
+ */
+Distributor::Distributor(PcapGlobalHdr globalHdr, std::string fileDir, 
+                         const OutputOptions& outputOptions,
+                         const Checkpoint* resume)
     : m_stopFlag(false) {
-    std::string result1Path = fileDir + "/result_1.pcap";
-    std::string result2Path = fileDir + "/result_2.pcap";
-    std::string result3Path = fileDir + "/result_3.pcap";
+    std::unique_ptr<IOutput> outputs[3];
+
+    for (size_t i = 0; i < 3; i++) {
+        std::string num = std::to_string(i + 1);
+        if (!outputOptions.udpIp.empty()) {
+            outputs[i].reset(new SocketOutput(globalHdr, outputOptions.udpIp, outputOptions.udpPort + i,
+                                              outputOptions.sendBatch, outputOptions.paceSpeed,
+                                              m_paceOrigin));
+        } else if (!outputOptions.unixPath.empty()) {
+            outputs[i].reset(new SocketOutput(globalHdr, outputOptions.unixPath + "_" + num,
+                                              outputOptions.sendBatch, outputOptions.paceSpeed,
+                                              m_paceOrigin));
+        } else if (!outputOptions.shmName.empty()) {
+            outputs[i].reset(new ShmRingOutput(globalHdr, outputOptions.shmName + "_" + num,
+                                               outputOptions.shmSize));
+        } else {
+            outputs[i].reset(new FileOutput(globalHdr, fileDir + "/result_" + num + ".pcap",
+                                            outputOptions, 
+                                            resume ? &resume->handlers[i] : nullptr));
+        }
+    }
 
     m_handlers[0] = new Handler1(m_handler1_mtx, m_handler1_cv, 
                                  m_handler1_queue, m_stopFlag, 
-                                 globalHdr, result1Path);
+                                 std::move(outputs[0]));
     m_handlers[1] = new Handler2(m_handler2_mtx, m_handler2_cv, 
                                  m_handler2_queue, m_stopFlag, 
-                                 globalHdr, result2Path);
+                                 std::move(outputs[1]));
     m_handlers[2] = new Handler3(m_handler3_mtx, m_handler3_cv, 
                                  m_handler3_queue, m_stopFlag, 
-                                 globalHdr, result3Path);
+                                 std::move(outputs[2]));
+
+    if (resume) {
+        for (size_t i = 0; i < 3; i++) {
+            std::istringstream state(resume->handlers[i].state);
+            m_handlers[i]->loadState(state);
+        }
+    }
 }
 
 Distributor::~Distributor() {
@@ -40,6 +73,14 @@ Distributor::~Distributor() {
  *          - Handler 3: all other packets.
  */
 void Distributor::distrPacket(struct PcapPacket packet) {
+    if (!m_paceOrigin.started) {
+        // Set before the packet is queued, so handlers always see it fixed
+        m_paceOrigin.tsSec = packet.pcapHdr.tsSec;
+        m_paceOrigin.tsFrac = packet.pcapHdr.tsUsec;
+        m_paceOrigin.startTime = std::chrono::steady_clock::now();
+        m_paceOrigin.started = true;
+    }
+
     uint32_t destIp = changeEndian(packet.ipHdr.destIp);
 
     if ( destIp >= 0xB000003 && destIp <= 0xB0000C9) { // Handler 1
@@ -86,4 +127,23 @@ void Distributor::stop() {
     for (size_t i = 0; i < 3; i++) {
         pthread_join(m_threads[i], nullptr);  // Waits for all handler threads to finish.
     }
-}
\ No newline at end of file
+}
+
+/**
+ * No new packets arrive while this method runs, because the only
+ * producer is the caller itself. Once all handlers are idle, their
+ * outputs contain exactly the packets distributed so far.
+ */
+bool Distributor::checkpoint(Checkpoint& result) {
+    for (size_t i = 0; i < 3; i++) {
+        m_handlers[i]->waitIdle();
+    }
+
+    result.handlers.assign(3, HandlerCheckpoint());
+    for (size_t i = 0; i < 3; i++) {
+        if (!m_handlers[i]->checkpoint(result.handlers[i])) {
+            return false;
+        }
+    }
+    return true;
+}
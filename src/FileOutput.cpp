@@ -0,0 +1,202 @@
+#include "Output.h"
+
+#include <iostream>
+#include <cstdio>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace {
+
+/**
+ * Creates an empty segment file and reserves `prealloc` bytes for it
+ * without changing its size, so a crash never leaves zero-filled tails.
+ * Preallocation is best effort: file systems without fallocate() simply
+ * allocate on write.
+ */
+std::ofstream createSegment(const std::string& path, uint64_t prealloc) {
+    int fd = open(path.c_str(), O_CREAT | O_WRONLY | O_TRUNC, 0644);
+    if (fd < 0) {
+        return std::ofstream();
+    }
+    if (prealloc) {
+        fallocate(fd, FALLOC_FL_KEEP_SIZE, 0, prealloc);
+    }
+    close(fd);
+
+    // Opening without truncation keeps the preallocated blocks
+    return std::ofstream(path, std::fstream::in | std::fstream::out | std::fstream::binary);
+}
+
+} // namespace
+
+FileOutput::FileOutput(PcapGlobalHdr globalHdr, const std::string& filePath,
+                       const OutputOptions& options, const HandlerCheckpoint* resume)
+    : m_filePath(filePath), m_globalHdr(globalHdr),
+    m_rotateBytes(options.rotateBytes),
+    m_rotateSeconds(options.rotateSeconds) {
+
+    if (resume) {
+        m_segment = resume->outputSegment;
+        std::string path = rotating() ? segmentPath(m_segment) : m_filePath;
+
+        // Segments created after the checkpoint are dropped
+        if (rotating()) {
+            for (uint32_t i = m_segment + 1; unlink(segmentPath(i).c_str()) == 0; i++) {}
+        }
+
+        // Drop everything written after the checkpoint and continue from there
+        struct stat st;
+        if (stat(path.c_str(), &st) != 0 ||
+            (uint64_t)st.st_size < resume->outputOffset ||
+            truncate(path.c_str(), resume->outputOffset) != 0) {
+            std::cerr << "\033[31mОшибка файла:\033[0m Файл результата \"" << path << "\" не соответствует контрольной точке\n";
+            exit(1);
+        }
+        m_outpFile.open(path, std::fstream::in | std::fstream::out |
+                              std::fstream::binary | std::fstream::ate);
+        m_written = resume->outputOffset;
+        m_hasPacket = m_written > sizeof(PcapGlobalHdr);
+
+        // The capture-time interval of the segment is that of its first packet
+        PcapPacketHdr firstHdr;
+        std::ifstream segment(path, std::fstream::in | std::fstream::binary);
+        segment.seekg(sizeof(PcapGlobalHdr));
+        if (m_rotateSeconds && segment.read((char*)&firstHdr, sizeof(firstHdr))) {
+            m_slot = firstHdr.tsSec / m_rotateSeconds;
+            m_slotSet = true;
+        }
+    } else if (rotating()) {
+        m_outpFile = createSegment(segmentPath(0), m_rotateBytes);
+    } else {
+        // Open the output file for writing in binary mode
+        m_outpFile.open(filePath, std::fstream::out | std::fstream::binary);
+    }
+
+    if (!m_outpFile.is_open()) {
+        std::cerr << "\033[31mОшибка файла:\033[0m Не удалось открыть файл для записи результата \"" << filePath << "\"\n";
+        exit(1);
+    }
+
+    if (!resume) {
+        // Write the global header to the file
+        m_outpFile.write((char*)&globalHdr, sizeof(globalHdr));
+        m_written = sizeof(globalHdr);
+    }
+
+    if (rotating()) {
+        prepareNext(m_rotateBytes);
+    }
+}
+
+/**
+ * Closes the output file and removes the segment that was prepared
+ * but never used.
+ */
+FileOutput::~FileOutput() {
+    closeSegment();
+
+    if (m_next.valid()) {
+        m_next.get().close();
+        unlink(segmentPath(m_segment + 1).c_str());
+    }
+}
+
+void FileOutput::write(const PcapPacketHdr& pcapHdr, const uint8_t* data) {
+    uint64_t recordSize = sizeof(pcapHdr) + pcapHdr.inclLen;
+
+    if (rotating()) {
+        // Packets slightly out of order stay in the current segment
+        uint64_t slot = m_rotateSeconds ? pcapHdr.tsSec / m_rotateSeconds : 0;
+        if (m_hasPacket && ((m_rotateBytes && m_written + recordSize > m_rotateBytes) ||
+                            (m_slotSet && slot > m_slot))) {
+            rotate();
+        }
+        if (!m_slotSet) {
+            m_slot = slot;
+            m_slotSet = true;
+        }
+        m_hasPacket = true;
+    }
+
+    m_outpFile.write((const char*)&pcapHdr, sizeof(pcapHdr));
+    m_outpFile.write(reinterpret_cast<const char*>(data), pcapHdr.inclLen);
+    m_written += recordSize;
+}
+
+/**
+ * The offset is taken after flushing the stream, so it matches the
+ * size of the output file on disk. Segments closed since the last
+ * checkpoint are synced here rather than on rotation, which would
+ * stall the handler.
+ */
+bool FileOutput::checkpoint(HandlerCheckpoint& checkpoint) {
+    for (uint32_t segment : m_unsynced) {
+        if (!syncFile(segmentPath(segment))) {
+            return false;
+        }
+    }
+    m_unsynced.clear();
+
+    if (!m_outpFile.flush() || 
+        !syncFile(rotating() ? segmentPath(m_segment) : m_filePath)) {
+        return false;
+    }
+    checkpoint.outputSegment = m_segment;
+    checkpoint.outputOffset = m_written;
+    return true;
+}
+
+std::string FileOutput::segmentPath(uint32_t segment) const {
+    std::string base = m_filePath;
+    if (base.size() >= 5 && base.compare(base.size() - 5, 5, ".pcap") == 0) {
+        base.resize(base.size() - 5);
+    }
+
+    char suffix[32];
+    snprintf(suffix, sizeof(suffix), "_%06u.pcap", segment);
+    return base + suffix;
+}
+
+/**
+ * Without a size limit the next segment is preallocated to the size of
+ * the previous one, which is the best estimate for time-based rotation.
+ */
+void FileOutput::prepareNext(uint64_t prealloc) {
+    std::string path = segmentPath(m_segment + 1);
+    m_next = std::async(std::launch::async, createSegment, path, prealloc);
+}
+
+void FileOutput::rotate() {
+    uint64_t prevSize = m_written;
+    closeSegment();
+
+    m_outpFile = m_next.get();
+    m_segment++;
+    if (!m_outpFile.is_open()) {
+        std::cerr << "\033[31mОшибка файла:\033[0m Не удалось открыть файл для записи результата \"" << segmentPath(m_segment) << "\"\n";
+        exit(1);
+    }
+
+    m_outpFile.write((char*)&m_globalHdr, sizeof(m_globalHdr));
+    m_written = sizeof(m_globalHdr);
+    m_slotSet = false;
+    m_hasPacket = false;
+
+    prepareNext(m_rotateBytes ? m_rotateBytes : prevSize);
+}
+
+/**
+ * Truncating to the written size releases the space preallocated past
+ * the end of the segment.
+ */
+void FileOutput::closeSegment() {
+    if (!m_outpFile.is_open()) {
+        return;
+    }
+    m_outpFile.close();
+    if (rotating()) {
+        truncate(segmentPath(m_segment).c_str(), m_written);
+        m_unsynced.push_back(m_segment);
+    }
+}
@@ -16,7 +16,21 @@ void Handler1::handlePckt(PcapPacket& packet) {
         std::cout << "\033[32mОбработчик 1:\033[0m пакет под номером " << m_packetNum << " игнорируется\n";
     } else {
         // Write the packet's header and data to the output file
-        m_outpFile.write((char*)&packet.pcapHdr, sizeof(packet.pcapHdr));
-        m_outpFile.write(reinterpret_cast<const char*>(packet.data.data()), packet.pcapHdr.inclLen);
+        writePacket(packet);
     }  
 }
+
+void Handler1::saveState(std::ostream& os) const {
+    uint64_t packetNum = m_packetNum;
+    os.write((const char*)&packetNum, sizeof(packetNum));
+}
+
+/**
+ * Restores the packet counter so that the numbers of ignored packets
+ * printed after a resume continue the numbering of the interrupted run.
+ */
+void Handler1::loadState(std::istream& is) {
+    uint64_t packetNum = 0;
+    is.read((char*)&packetNum, sizeof(packetNum));
+    m_packetNum = packetNum;
+}
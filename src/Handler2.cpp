@@ -26,7 +26,6 @@ void Handler2::handlePckt(PcapPacket& packet) {
     // If 'x' is found, truncate the packet at the position of 'x' and write it to the output file
     if (found != L4Header + s) {
         packet.pcapHdr.inclLen = found - L4Header + sizeof(EthHdr) + sizeof(IpHdr) + 1;
-        m_outpFile.write((char*)&packet.pcapHdr, sizeof(packet.pcapHdr));
-        m_outpFile.write(reinterpret_cast<const char*>(packet.data.data()), packet.pcapHdr.inclLen);
+        writePacket(packet);
     }
 }
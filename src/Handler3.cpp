@@ -26,14 +26,12 @@ void Handler3::handlePckt(PcapPacket& packet) {
         // Check if current system time is even
         if (!(time(NULL) & 1)) {
             // Write packet to output file if time is even
-            m_outpFile.write((char*)&packet.pcapHdr, sizeof(packet.pcapHdr));
-            m_outpFile.write(reinterpret_cast<const char*>(packet.data.data()), packet.pcapHdr.inclLen);
+            writePacket(packet);
         }
     } else if (packet.udpHdr.srcPort == packet.udpHdr.destPort) {
         // Handle UDP packets with matching source and destination port
         // Write packet to output file
-        m_outpFile.write((char*)&packet.pcapHdr, sizeof(packet.pcapHdr));
-        m_outpFile.write(reinterpret_cast<const char*>(packet.data.data()), packet.pcapHdr.inclLen);
+        writePacket(packet);
 
         // Print a message indicating matching ports
         std::cout << "\033[32mОбработчик 3:\033[0m Найдено совпадение port = " << packet.udpHdr.srcPort << std::endl;
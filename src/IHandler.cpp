@@ -1,36 +1,19 @@
 #include "Handler.h"
 #include <iostream>
+#include <sstream>
 
 IHandler::IHandler(std::mutex& mtx, 
                    std::condition_variable& cv,
              	   std::queue<PcapPacket>& pcktQueue,
              	   std::atomic<bool>& stopFlag,
-             	   PcapGlobalHdr globalHdr,
-             	   std::string& filePath)
-    : m_mtx(mtx), m_cv(cv), 
+             	   std::unique_ptr<IOutput> output)
+    : m_output(std::move(output)), 
+    m_mtx(mtx), m_cv(cv), 
     m_pcktQueue(pcktQueue), 
     m_stopFlag(stopFlag) {
-
-   	// Open the output file for writing in binary mode
-    m_outpFile.open(filePath, std::fstream::out | std::fstream::binary);
-
-    if (!m_outpFile.is_open()) {
-        std::cerr << "\033[31mОшибка файла:\033[0m Не удалось открыть файл для записи результата \"" << filePath << "\"\n";
-        exit(1);
-    }
-
-    // Write the global header to the file
-    m_outpFile.write((char*)&globalHdr, sizeof(globalHdr));
 }
 
-/**
- * Closes the output file if it is open.
- */
-IHandler::~IHandler() {
-    if (m_outpFile.is_open()) {
-        m_outpFile.close();
-    }
-}
+IHandler::~IHandler() = default;
 
 /**
  * This function is executed in a separate thread and calls the `process` method.
@@ -59,8 +42,45 @@ void IHandler::process() {
 
         PcapPacket packet = std::move(m_pcktQueue.front());
         m_pcktQueue.pop();
+        m_busy = true;
         lock.unlock();
 
         handlePckt(packet);
+
+        lock.lock();
+        if (m_pcktQueue.empty()) {
+            // Still busy, so a checkpoint does not use the output meanwhile
+            lock.unlock();
+            m_output->idle();
+            lock.lock();
+        }
+        m_busy = false;
+        if (m_pcktQueue.empty()) {
+            m_idleCv.notify_all(); // Wakes up a pending waitIdle().
+        }
     }    
+}
+
+/**
+ * Writes the PCAP record header followed by the first `inclLen` bytes
+ * of the packet data.
+ */
+void IHandler::writePacket(const PcapPacket& packet) {
+    m_output->write(packet.pcapHdr, packet.data.data());
+}
+
+void IHandler::waitIdle() {
+    std::unique_lock<std::mutex> lock(m_mtx);
+    m_idleCv.wait(lock, [this]{ return m_pcktQueue.empty() && !m_busy; });
+}
+
+bool IHandler::checkpoint(HandlerCheckpoint& result) {
+    if (!m_output->checkpoint(result)) {
+        return false;
+    }
+
+    std::ostringstream state;
+    saveState(state);
+    result.state = state.str();
+    return true;
 }
\ No newline at end of file
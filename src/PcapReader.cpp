@@ -0,0 +1,423 @@
+#include "PcapReader.h"
+#include "Utilities.h"
+
+#include <iostream>
+#include <istream>
+#include <ostream>
+#include <cstring>
+#include <algorithm>
+
+namespace {
+
+const uint32_t NG_SHB = 0x0A0D0D0A; ///< Section Header Block, same in both byte orders.
+const uint32_t NG_IDB = 0x00000001; ///< Interface Description Block.
+const uint32_t NG_PB  = 0x00000002; ///< Packet Block (obsolete).
+const uint32_t NG_SPB = 0x00000003; ///< Simple Packet Block.
+const uint32_t NG_EPB = 0x00000006; ///< Enhanced Packet Block.
+
+const uint32_t NG_BYTE_ORDER_MAGIC = 0x1A2B3C4D;
+
+const uint16_t NG_OPT_END = 0;
+const uint16_t NG_OPT_IF_TSRESOL = 9;
+const uint16_t NG_OPT_IF_TSOFFSET = 14;
+
+const uint32_t DEFAULT_SNAPLEN = 262144;
+const uint32_t LINKTYPE_ETHERNET = 1;
+
+/// Returns true if the block carries a packet.
+bool isPacketBlock(uint32_t type) {
+    return type == NG_EPB || type == NG_SPB || type == NG_PB;
+}
+
+} // namespace
+
+PcapReader::PcapReader(std::ifstream& pcapFs)
+    : m_fs(pcapFs) {
+    uint32_t magic = 0;
+    m_fs.read((char*)&magic, sizeof(magic));
+    m_fs.seekg(0);
+
+    if (magic == NG_SHB) {
+        m_isNg = true;
+        openNg();
+    } else {
+        openClassic();
+    }
+}
+
+void PcapReader::seek(uint64_t offset) {
+    m_fs.clear();
+    m_fs.seekg(offset);
+    m_offset = offset;
+}
+
+void PcapReader::saveState(std::ostream& os) const {
+    if (!m_isNg) {
+        return;
+    }
+
+    uint8_t swap = m_swap;
+    uint32_t interfaceNum = m_interfaces.size();
+    os.write((const char*)&swap, sizeof(swap));
+    os.write((const char*)&m_sectionOffset, sizeof(m_sectionOffset));
+    os.write((const char*)&interfaceNum, sizeof(interfaceNum));
+    for (const Interface& iface : m_interfaces) {
+        os.write((const char*)&iface.linkType, sizeof(iface.linkType));
+        os.write((const char*)&iface.snapLen, sizeof(iface.snapLen));
+        os.write((const char*)&iface.unitsPerSec, sizeof(iface.unitsPerSec));
+        os.write((const char*)&iface.tsOffset, sizeof(iface.tsOffset));
+    }
+}
+
+/**
+ * The saved section offset must point at a Section Header Block of 
+ * this file, which catches most checkpoints of a different capture.
+ */
+bool PcapReader::loadState(std::istream& is) {
+    if (!m_isNg) {
+        return true;
+    }
+
+    uint8_t swap;
+    uint64_t sectionOffset;
+    uint32_t interfaceNum;
+    if (!is.read((char*)&swap, sizeof(swap)) ||
+        !is.read((char*)&sectionOffset, sizeof(sectionOffset)) ||
+        !is.read((char*)&interfaceNum, sizeof(interfaceNum))) {
+        return false;
+    }
+
+    std::vector<Interface> interfaces(interfaceNum);
+    for (Interface& iface : interfaces) {
+        if (!is.read((char*)&iface.linkType, sizeof(iface.linkType)) ||
+            !is.read((char*)&iface.snapLen, sizeof(iface.snapLen)) ||
+            !is.read((char*)&iface.unitsPerSec, sizeof(iface.unitsPerSec)) ||
+            !is.read((char*)&iface.tsOffset, sizeof(iface.tsOffset)) ||
+            iface.unitsPerSec == 0) {
+            return false;
+        }
+    }
+
+    uint32_t type = 0;
+    m_fs.clear();
+    m_fs.seekg(sectionOffset);
+    if (!m_fs.read((char*)&type, sizeof(type)) || type != NG_SHB) {
+        return false;
+    }
+
+    m_swap = swap;
+    m_sectionOffset = sectionOffset;
+    m_interfaces = std::move(interfaces);
+    m_readNext = m_swap ? &PcapReader::readNg<true> : &PcapReader::readNg<false>;
+    return true;
+}
+
+/**
+ * The magic number tells both the byte order and the timestamp 
+ * resolution. The global header is converted to host byte order.
+ */
+void PcapReader::openClassic() {
+    PcapGlobalHdr hdr;
+    if (!m_fs.read((char*)&hdr, sizeof(hdr))) {
+        formatError();
+    }
+    m_offset = sizeof(hdr);
+
+    bool swap = hdr.magicNumber == changeEndian(PCAP_MAGIC_USEC) || 
+                hdr.magicNumber == changeEndian(PCAP_MAGIC_NSEC);
+    if (swap) {
+        hdr.magicNumber = changeEndian(hdr.magicNumber);
+        hdr.versionMajor = changeEndian(hdr.versionMajor);
+        hdr.versionMinor = changeEndian(hdr.versionMinor);
+        hdr.thisZone = (int32_t)changeEndian((uint32_t)hdr.thisZone);
+        hdr.sigFigs = changeEndian(hdr.sigFigs);
+        hdr.snapLen = changeEndian(hdr.snapLen);
+        hdr.network = changeEndian(hdr.network);
+    }
+    if (hdr.magicNumber != PCAP_MAGIC_USEC && hdr.magicNumber != PCAP_MAGIC_NSEC) {
+        formatError();
+    }
+
+    m_globalHdr = hdr;
+    m_outUnitsPerSec = pcapTsUnitsPerSec(hdr);
+    m_readNext = swap ? &PcapReader::readClassic<true> : &PcapReader::readClassic<false>;
+}
+
+/**
+ * The output header is built from the first interface: its link type
+ * and snaplen, and nanosecond timestamps if it is more precise than 
+ * microseconds. Blocks are scanned up to the first packet, which may 
+ * be in a later section, and the stream is then returned to the start
+ * of the first section.
+ */
+void PcapReader::openNg() {
+    uint32_t hdr[2];
+    if (!m_fs.read((char*)hdr, sizeof(hdr)) || !readShb(hdr[1])) {
+        formatError();
+    }
+
+    Interface first;
+    bool hasInterface = false;
+    uint32_t type;
+    while (scanNgBlock(type) && !isPacketBlock(type)) {
+        if (!hasInterface && !m_interfaces.empty()) {
+            first = m_interfaces.front();
+            hasInterface = true;
+        }
+    }
+
+    m_fs.clear();
+    m_fs.seekg(0);
+    m_offset = 0;
+    if (!m_fs.read((char*)hdr, sizeof(hdr)) || !readShb(hdr[1])) {
+        formatError();
+    }
+
+    m_globalHdr.magicNumber = PCAP_MAGIC_USEC;
+    m_globalHdr.versionMajor = 2;
+    m_globalHdr.versionMinor = 4;
+    m_globalHdr.thisZone = 0;
+    m_globalHdr.sigFigs = 0;
+    m_globalHdr.snapLen = DEFAULT_SNAPLEN;
+    m_globalHdr.network = LINKTYPE_ETHERNET;
+
+    if (hasInterface) {
+        if (first.unitsPerSec > 1000000) {
+            m_globalHdr.magicNumber = PCAP_MAGIC_NSEC;
+        }
+        if (first.snapLen) {
+            m_globalHdr.snapLen = first.snapLen;
+        }
+        m_globalHdr.network = first.linkType;
+    }
+    m_outUnitsPerSec = pcapTsUnitsPerSec(m_globalHdr);
+}
+
+/**
+ * The block length is only known after the byte-order magic has been
+ * read. A new section may change the byte order, so the parse routine 
+ * is selected again and all interfaces of the previous section are 
+ * forgotten.
+ */
+bool PcapReader::readShb(uint32_t rawLen) {
+    uint32_t magic;
+    if (!m_fs.read((char*)&magic, sizeof(magic))) {
+        return false;
+    }
+
+    if (magic == NG_BYTE_ORDER_MAGIC) {
+        m_swap = false;
+    } else if (magic == changeEndian(NG_BYTE_ORDER_MAGIC)) {
+        m_swap = true;
+    } else {
+        return false;
+    }
+
+    uint32_t len = m_swap ? changeEndian(rawLen) : rawLen;
+    if (len < 28 || len % 4) {
+        return false;
+    }
+    m_sectionOffset = m_offset;
+    m_offset += len;
+    m_fs.seekg(m_offset);
+
+    m_interfaces.clear();
+    m_readNext = m_swap ? &PcapReader::readNg<true> : &PcapReader::readNg<false>;
+    return true;
+}
+
+bool PcapReader::scanNgBlock(uint32_t& type) {
+    return m_swap ? readNgBlock<true>(type, false) : readNgBlock<false>(type, false);
+}
+
+template <bool Swap>
+bool PcapReader::readClassic(PcapPacket& packet) {
+    PcapPacketHdr& hdr = packet.pcapHdr;
+    if (!m_fs.read((char*)&hdr, sizeof(hdr))) {
+        return false;
+    }
+
+    hdr.tsSec = fromFileOrder<Swap>(hdr.tsSec);
+    hdr.tsUsec = fromFileOrder<Swap>(hdr.tsUsec);
+    hdr.inclLen = fromFileOrder<Swap>(hdr.inclLen);
+    hdr.origLen = fromFileOrder<Swap>(hdr.origLen);
+
+    packet.data.resize(hdr.inclLen);
+    if (!m_fs.read(reinterpret_cast<char*>(packet.data.data()), hdr.inclLen)) {
+        return false;
+    }
+    m_offset += sizeof(hdr) + hdr.inclLen;
+    return true;
+}
+
+template <bool Swap>
+bool PcapReader::readNg(PcapPacket& packet) {
+    uint32_t type;
+    while (readNgBlock<Swap>(type, true)) {
+        if (type == NG_SHB) {
+            // The new section may use the other byte order
+            return (this->*m_readNext)(packet);
+        }
+        if (isPacketBlock(type)) {
+            parsePacketBlock<Swap>(type, packet);
+            return true;
+        }
+    }
+    return false;
+}
+
+/**
+ * Packet blocks are loaded into the buffer if `loadPackets` is set and 
+ * skipped otherwise. Section and interface blocks are always applied,
+ * all other blocks are skipped. Loaded blocks are read in one piece 
+ * including the trailing length, so the stream is only repositioned 
+ * for skipped blocks.
+ */
+template <bool Swap>
+bool PcapReader::readNgBlock(uint32_t& type, bool loadPackets) {
+    uint32_t hdr[2];
+    if (!m_fs.read((char*)hdr, sizeof(hdr))) {
+        return false;
+    }
+
+    type = fromFileOrder<Swap>(hdr[0]);
+    if (type == NG_SHB) {
+        if (!readShb(hdr[1])) {
+            formatError();
+        }
+        return true;
+    }
+
+    uint32_t len = fromFileOrder<Swap>(hdr[1]);
+    if (len < 12 || len % 4) {
+        formatError();
+    }
+
+    if (type == NG_IDB || (loadPackets && isPacketBlock(type))) {
+        m_block.resize(len - 8);
+        if (!m_fs.read((char*)m_block.data(), m_block.size())) {
+            return false;
+        }
+        m_offset += len;
+        if (type == NG_IDB) {
+            parseIdb<Swap>();
+        }
+    } else {
+        m_offset += len;
+        m_fs.seekg(m_offset);
+    }
+    return true;
+}
+
+template <bool Swap>
+void PcapReader::parseIdb() {
+    size_t bodyLen = bodySize();
+    if (bodyLen < 8) {
+        formatError();
+    }
+
+    Interface iface;
+    iface.linkType = field<Swap, uint16_t>(0);
+    iface.snapLen = field<Swap, uint32_t>(4);
+
+    for (size_t pos = 8; pos + 4 <= bodyLen; ) {
+        uint16_t code = field<Swap, uint16_t>(pos);
+        uint16_t len = field<Swap, uint16_t>(pos + 2);
+        pos += 4;
+        if (code == NG_OPT_END || pos + len > bodyLen) {
+            break;
+        }
+
+        if (code == NG_OPT_IF_TSRESOL && len >= 1) {
+            // MSB clear: 10^-n seconds, MSB set: 2^-n seconds
+            uint8_t resol = m_block[pos];
+            uint64_t base = (resol & 0x80) ? 2 : 10;
+            uint8_t exp = std::min<uint8_t>(resol & 0x7F, base == 2 ? 63 : 19);
+            iface.unitsPerSec = 1;
+            for (uint8_t i = 0; i < exp; i++) {
+                iface.unitsPerSec *= base;
+            }
+        } else if (code == NG_OPT_IF_TSOFFSET && len >= 8) {
+            iface.tsOffset = (int64_t)field<Swap, uint64_t>(pos);
+        }
+        pos += (len + 3) & ~3;
+    }
+    m_interfaces.push_back(iface);
+}
+
+/**
+ * Enhanced and obsolete Packet Blocks share the layout after the 
+ * interface id. Simple Packet Blocks have no timestamp and belong to 
+ * the first interface.
+ */
+template <bool Swap>
+void PcapReader::parsePacketBlock(uint32_t type, PcapPacket& packet) {
+    PcapPacketHdr& hdr = packet.pcapHdr;
+    size_t bodyLen = bodySize();
+    size_t dataPos;
+
+    if (type == NG_SPB) {
+        if (bodyLen < 4 || m_interfaces.empty()) {
+            formatError();
+        }
+        dataPos = 4;
+        hdr.origLen = field<Swap, uint32_t>(0);
+        hdr.inclLen = std::min<uint64_t>(hdr.origLen, bodyLen - dataPos);
+        if (m_interfaces[0].snapLen) {
+            hdr.inclLen = std::min(hdr.inclLen, m_interfaces[0].snapLen);
+        }
+        hdr.tsSec = 0;
+        hdr.tsUsec = 0;
+    } else {
+        if (bodyLen < 20) {
+            formatError();
+        }
+        uint32_t ifId = type == NG_EPB ? field<Swap, uint32_t>(0) : field<Swap, uint16_t>(0);
+        if (ifId >= m_interfaces.size()) {
+            formatError();
+        }
+        uint64_t ts = ((uint64_t)field<Swap, uint32_t>(4) << 32) | field<Swap, uint32_t>(8);
+        convertTs(m_interfaces[ifId], ts, hdr);
+
+        dataPos = 20;
+        hdr.inclLen = field<Swap, uint32_t>(12);
+        hdr.origLen = field<Swap, uint32_t>(16);
+        if (hdr.inclLen > bodyLen - dataPos) {
+            formatError();
+        }
+    }
+
+    packet.data.assign(m_block.begin() + dataPos, m_block.begin() + dataPos + hdr.inclLen);
+}
+
+template <bool Swap, typename T>
+T PcapReader::field(size_t pos) const {
+    T value;
+    memcpy(&value, m_block.data() + pos, sizeof(value));
+    return fromFileOrder<Swap>(value);
+}
+
+/**
+ * Decimal resolutions are converted exactly; binary ones are rounded 
+ * down to the output resolution.
+ */
+void PcapReader::convertTs(const Interface& iface, uint64_t ts, PcapPacketHdr& hdr) const {
+    uint64_t units = iface.unitsPerSec;
+    uint64_t frac = ts % units;
+
+    if (units % m_outUnitsPerSec == 0) {
+        frac /= units / m_outUnitsPerSec;
+    } else if (m_outUnitsPerSec % units == 0) {
+        frac *= m_outUnitsPerSec / units;
+    } else {
+        frac = (uint64_t)((long double)frac * m_outUnitsPerSec / units);
+    }
+
+    hdr.tsSec = (uint32_t)(ts / units + iface.tsOffset);
+    hdr.tsUsec = (uint32_t)frac;
+}
+
+void PcapReader::formatError() const {
+    std::cerr << "\033[31mОшибка формата:\033[0m Некорректная структура заголовка pcap.\n";
+    exit(1);
+}
@@ -0,0 +1,124 @@
+#include "Output.h"
+#include "ShmRing.h"
+
+#include <iostream>
+#include <cstring>
+#include <new>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+static_assert(std::atomic<uint64_t>::is_always_lock_free,
+              "shared-memory ring requires lock-free 64-bit atomics");
+
+namespace {
+
+/// Rounds `size` up to the record alignment.
+uint64_t alignRecord(uint64_t size) {
+    return (size + SHM_RING_ALIGN - 1) & ~(uint64_t)(SHM_RING_ALIGN - 1);
+}
+
+} // namespace
+
+/**
+ * An existing segment with the same name is unlinked first, so readers
+ * still attached to it keep their mapping while new readers see the
+ * new ring.
+ */
+ShmRingOutput::ShmRingOutput(PcapGlobalHdr globalHdr, const std::string& name,
+                             size_t capacity) {
+    uint64_t ringSize = 1;
+    while (ringSize < capacity) {
+        ringSize *= 2;
+    }
+
+    // Every record must fit into a quarter of the ring
+    uint64_t maxRecord = alignRecord(sizeof(ShmRecordHdr) + sizeof(PcapPacketHdr) + globalHdr.snapLen);
+    if (ringSize < 4 * maxRecord) {
+        std::cerr << "\033[31mОшибка памяти:\033[0m Размер кольцевого буфера \"" << name << "\" слишком мал для snaplen " << globalHdr.snapLen << "\n";
+        exit(1);
+    }
+
+    shm_unlink(name.c_str());
+    int fd = shm_open(name.c_str(), O_CREAT | O_EXCL | O_RDWR, 0644);
+    m_mapSize = SHM_RING_DATA_OFFSET + ringSize;
+    if (fd < 0 || ftruncate(fd, m_mapSize) != 0) {
+        std::cerr << "\033[31mОшибка памяти:\033[0m Не удалось создать разделяемую память \"" << name << "\"\n";
+        exit(1);
+    }
+
+    void* mem = mmap(nullptr, m_mapSize, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (mem == MAP_FAILED) {
+        std::cerr << "\033[31mОшибка памяти:\033[0m Не удалось отобразить разделяемую память \"" << name << "\"\n";
+        exit(1);
+    }
+
+    m_hdr = new (mem) ShmRingHdr();
+    m_data = static_cast<uint8_t*>(mem) + SHM_RING_DATA_OFFSET;
+    m_mask = ringSize - 1;
+
+    m_hdr->version = SHM_RING_VERSION;
+    m_hdr->capacity = ringSize;
+    m_hdr->writerPid = getpid();
+    m_hdr->globalHdr = globalHdr;
+    std::atomic_thread_fence(std::memory_order_release);
+    m_hdr->magic = SHM_RING_MAGIC; // Readers may attach from now on.
+}
+
+ShmRingOutput::~ShmRingOutput() {
+    m_hdr->closed.store(1, std::memory_order_release);
+    munmap(m_hdr, m_mapSize);
+}
+
+/**
+ * The record is written in three steps: the reserved end is announced
+ * first, then the bytes are copied, then the record is published. A
+ * reader that copied a record checks the reserved end afterwards to
+ * detect whether the writer could have overwritten it meanwhile.
+ */
+void ShmRingOutput::write(const PcapPacketHdr& pcapHdr, const uint8_t* data) {
+    uint64_t size = alignRecord(sizeof(ShmRecordHdr) + sizeof(PcapPacketHdr) + pcapHdr.inclLen);
+    if (size > (m_mask + 1) / 4) {
+        return; // Larger than snaplen, cannot be published.
+    }
+
+    uint64_t pos = m_writePos;
+    uint64_t padding = 0;
+    if ((pos & m_mask) + size > m_mask + 1) {
+        padding = m_mask + 1 - (pos & m_mask);
+    }
+    uint64_t end = pos + padding + size;
+
+    reserve(end);
+    m_hdr->reservePos.store(end, std::memory_order_release);
+    std::atomic_thread_fence(std::memory_order_release);
+
+    if (padding) {
+        ShmRecordHdr padHdr = { (uint32_t)padding, SHM_RECORD_PADDING };
+        memcpy(m_data + (pos & m_mask), &padHdr, sizeof(padHdr));
+        pos += padding;
+    }
+
+    uint8_t* record = m_data + (pos & m_mask);
+    ShmRecordHdr recordHdr = { (uint32_t)size, 0 };
+    memcpy(record, &recordHdr, sizeof(recordHdr));
+    memcpy(record + sizeof(recordHdr), &pcapHdr, sizeof(pcapHdr));
+    memcpy(record + sizeof(recordHdr) + sizeof(pcapHdr), data, pcapHdr.inclLen);
+
+    m_writePos = end;
+    m_hdr->writePos.store(end, std::memory_order_release);
+}
+
+void ShmRingOutput::reserve(uint64_t end) {
+    bool moved = false;
+    while (end - m_tail > m_mask + 1) {
+        ShmRecordHdr recordHdr;
+        memcpy(&recordHdr, m_data + (m_tail & m_mask), sizeof(recordHdr));
+        m_tail += recordHdr.size;
+        moved = true;
+    }
+    if (moved) {
+        m_hdr->tailPos.store(m_tail, std::memory_order_release);
+    }
+}
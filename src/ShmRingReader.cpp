@@ -0,0 +1,123 @@
+#include "ShmRing.h"
+
+#include <cerrno>
+#include <cstring>
+#include <stdexcept>
+#include <fcntl.h>
+#include <signal.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+ShmRingReader::ShmRingReader(const std::string& name, bool fromOldest) {
+    int fd = shm_open(name.c_str(), O_RDONLY, 0);
+    if (fd < 0) {
+        throw std::runtime_error("cannot open shared memory \"" + name + "\"");
+    }
+
+    struct stat st;
+    if (fstat(fd, &st) != 0 || (size_t)st.st_size <= SHM_RING_DATA_OFFSET) {
+        close(fd);
+        throw std::runtime_error("shared memory \"" + name + "\" is not a ring");
+    }
+
+    m_mapSize = st.st_size;
+    void* mem = mmap(nullptr, m_mapSize, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (mem == MAP_FAILED) {
+        throw std::runtime_error("cannot map shared memory \"" + name + "\"");
+    }
+
+    m_hdr = static_cast<ShmRingHdr*>(mem);
+    m_data = static_cast<const uint8_t*>(mem) + SHM_RING_DATA_OFFSET;
+
+    uint32_t magic = m_hdr->magic;
+    std::atomic_thread_fence(std::memory_order_acquire);
+    if (magic != SHM_RING_MAGIC || m_hdr->version != SHM_RING_VERSION ||
+        SHM_RING_DATA_OFFSET + m_hdr->capacity != m_mapSize) {
+        munmap(mem, m_mapSize);
+        throw std::runtime_error("shared memory \"" + name + "\" is not a ring");
+    }
+
+    m_cursor = fromOldest ? m_hdr->tailPos.load(std::memory_order_acquire)
+                          : m_hdr->writePos.load(std::memory_order_acquire);
+}
+
+ShmRingReader::~ShmRingReader() {
+    munmap(m_hdr, m_mapSize);
+}
+
+/**
+ * The record is copied optimistically and validated afterwards: if the
+ * writer has reserved space reaching the record while it was being
+ * copied, the copy may be torn and the reader skips to the oldest
+ * intact record.
+ */
+ShmRingReader::Status ShmRingReader::next(PcapPacketHdr& pcapHdr, std::vector<uint8_t>& data) {
+    const uint64_t capacity = m_hdr->capacity;
+
+    while (true) {
+        bool closed = m_hdr->closed.load(std::memory_order_acquire);
+        uint64_t writePos = m_hdr->writePos.load(std::memory_order_acquire);
+        if (m_cursor == writePos) {
+            if (closed) {
+                return Status::Closed;
+            }
+            if (writerAlive()) {
+                return Status::Empty;
+            }
+            // The writer may have published or closed the ring just before exiting
+            if (m_hdr->closed.load(std::memory_order_acquire)) {
+                return Status::Closed;
+            }
+            if (m_hdr->writePos.load(std::memory_order_acquire) == m_cursor) {
+                return Status::Aborted;
+            }
+            continue;
+        }
+
+        uint64_t offset = m_cursor & (capacity - 1);
+        ShmRecordHdr recordHdr;
+        memcpy(&recordHdr, m_data + offset, sizeof(recordHdr));
+
+        bool valid = recordHdr.size >= sizeof(recordHdr) &&
+                     recordHdr.size <= capacity - offset;
+        bool padding = recordHdr.flags & SHM_RECORD_PADDING;
+        if (valid && !padding) {
+            memcpy(&pcapHdr, m_data + offset + sizeof(recordHdr), sizeof(pcapHdr));
+            valid = sizeof(recordHdr) + sizeof(pcapHdr) + (uint64_t)pcapHdr.inclLen <= recordHdr.size;
+            if (valid) {
+                const uint8_t* bytes = m_data + offset + sizeof(recordHdr) + sizeof(pcapHdr);
+                data.assign(bytes, bytes + pcapHdr.inclLen);
+            }
+        }
+
+        std::atomic_thread_fence(std::memory_order_acquire);
+        uint64_t reservePos = m_hdr->reservePos.load(std::memory_order_acquire);
+        if (reservePos - m_cursor > capacity || !valid) {
+            uint64_t tail = m_hdr->tailPos.load(std::memory_order_acquire);
+            if (tail > m_cursor) {
+                m_lostBytes += tail - m_cursor;
+                m_cursor = tail;
+            } else {
+                // The record is torn but the tail has not been published yet
+                m_lostBytes += writePos - m_cursor;
+                m_cursor = writePos;
+            }
+            return Status::Overrun;
+        }
+
+        m_cursor += recordHdr.size;
+        if (!padding) {
+            return Status::Packet;
+        }
+    }
+}
+
+/**
+ * Signal 0 only checks that the process exists. EPERM means it exists
+ * but belongs to another user, so only ESRCH counts as gone.
+ */
+bool ShmRingReader::writerAlive() const {
+    return kill(m_hdr->writerPid, 0) == 0 || errno != ESRCH;
+}
@@ -0,0 +1,158 @@
+#include "Output.h"
+
+#include <iostream>
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <thread>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+SocketOutput::SocketOutput(PcapGlobalHdr globalHdr, const std::string& ip, 
+                           uint16_t port, size_t batch, double paceSpeed,
+                           const PaceOrigin& paceOrigin)
+    : m_paceSpeed(paceSpeed), 
+    m_tsUnitsPerSec(pcapTsUnitsPerSec(globalHdr)),
+    m_paceOrigin(paceOrigin) {
+    memset(&m_addr, 0, sizeof(m_addr));
+    sockaddr_in* addr = (sockaddr_in*)&m_addr;
+    addr->sin_family = AF_INET;
+    addr->sin_port = htons(port);
+    m_addrLen = sizeof(sockaddr_in);
+
+    if (inet_pton(AF_INET, ip.c_str(), &addr->sin_addr) != 1) {
+        std::cerr << "\033[31mОшибка сокета:\033[0m Некорректный адрес \"" << ip << "\"\n";
+        exit(1);
+    }
+    init(AF_INET, ip + ":" + std::to_string(port), batch);
+}
+
+SocketOutput::SocketOutput(PcapGlobalHdr globalHdr, const std::string& path, 
+                           size_t batch, double paceSpeed,
+                           const PaceOrigin& paceOrigin)
+    : m_paceSpeed(paceSpeed), 
+    m_tsUnitsPerSec(pcapTsUnitsPerSec(globalHdr)),
+    m_paceOrigin(paceOrigin) {
+    memset(&m_addr, 0, sizeof(m_addr));
+    sockaddr_un* addr = (sockaddr_un*)&m_addr;
+    addr->sun_family = AF_UNIX;
+    m_addrLen = sizeof(sockaddr_un);
+
+    if (path.size() >= sizeof(addr->sun_path)) {
+        std::cerr << "\033[31mОшибка сокета:\033[0m Слишком длинный путь \"" << path << "\"\n";
+        exit(1);
+    }
+    memcpy(addr->sun_path, path.c_str(), path.size() + 1);
+    init(AF_UNIX, path, batch);
+}
+
+/**
+ * Reports the number of records that could not be sent, e.g. because
+ * nobody listened on the destination.
+ */
+SocketOutput::~SocketOutput() {
+    flush();
+    close(m_sock);
+
+    if (m_droppedNum) {
+        std::cerr << "\033[31mОшибка сокета:\033[0m Не удалось отправить пакетов: " << m_droppedNum << "\n";
+    }
+}
+
+/**
+ * The destination is set on every message instead of connecting the
+ * socket, so a receiver that starts later or restarts does not stop
+ * the output.
+ */
+void SocketOutput::init(int family, const std::string& name, size_t batch) {
+    m_sock = socket(family, SOCK_DGRAM, 0);
+    if (m_sock < 0) {
+        std::cerr << "\033[31mОшибка сокета:\033[0m Не удалось создать сокет для \"" << name << "\"\n";
+        exit(1);
+    }
+
+    batch = std::max<size_t>(batch, 1);
+    m_records.resize(batch);
+    m_iovs.resize(batch);
+    m_msgs.resize(batch);
+    memset(m_msgs.data(), 0, batch * sizeof(mmsghdr));
+
+    for (size_t i = 0; i < batch; i++) {
+        m_msgs[i].msg_hdr.msg_name = &m_addr;
+        m_msgs[i].msg_hdr.msg_namelen = m_addrLen;
+        m_msgs[i].msg_hdr.msg_iov = &m_iovs[i];
+        m_msgs[i].msg_hdr.msg_iovlen = 1;
+    }
+}
+
+/**
+ * When pacing, records are due relative to the shared time base, so a
+ * handler whose first packet comes late in the capture waits for it
+ * like the others. Pending records are sent before waiting for a
+ * later one and when the handler runs out of packets (see idle()),
+ * so no record is held back past its due time.
+ */
+void SocketOutput::write(const PcapPacketHdr& pcapHdr, const uint8_t* data) {
+    if (m_paceSpeed > 0) {
+        double ts = ((double)pcapHdr.tsSec - m_paceOrigin.tsSec) +
+                    ((double)pcapHdr.tsUsec - m_paceOrigin.tsFrac) / m_tsUnitsPerSec;
+
+        std::chrono::duration<double> delay(ts / m_paceSpeed);
+        Clock::time_point due = m_paceOrigin.startTime + std::chrono::duration_cast<Clock::duration>(delay);
+        if (due > Clock::now()) {
+            flush();
+            std::this_thread::sleep_until(due);
+        }
+    }
+
+    std::vector<uint8_t>& record = m_records[m_pending++];
+    record.resize(sizeof(pcapHdr) + pcapHdr.inclLen);
+    memcpy(record.data(), &pcapHdr, sizeof(pcapHdr));
+    memcpy(record.data() + sizeof(pcapHdr), data, pcapHdr.inclLen);
+
+    if (m_pending == m_records.size()) {
+        flush();
+    }
+}
+
+bool SocketOutput::checkpoint(HandlerCheckpoint&) {
+    flush();
+    return true;
+}
+
+/**
+ * Without pacing the next packet follows shortly and fills the batch,
+ * so only paced records, which are due once written, are sent here.
+ */
+void SocketOutput::idle() {
+    if (m_paceSpeed > 0) {
+        flush();
+    }
+}
+
+/**
+ * sendmmsg() stops at the first record that fails; that record is
+ * counted as dropped and sending continues with the next one.
+ */
+void SocketOutput::flush() {
+    for (size_t i = 0; i < m_pending; i++) {
+        m_iovs[i].iov_base = m_records[i].data();
+        m_iovs[i].iov_len = m_records[i].size();
+    }
+
+    size_t sent = 0;
+    while (sent < m_pending) {
+        int n = sendmmsg(m_sock, &m_msgs[sent], m_pending - sent, 0);
+        if (n < 0) {
+            if (errno != EINTR) {
+                m_droppedNum++;
+                sent++;
+            }
+            continue;
+        }
+        sent += n;
+    }
+    m_pending = 0;
+}
@@ -1,8 +1,14 @@
 #include <iostream>
 #include <fstream>
 #include <cstring>
+#include <cstdio>
+#include <memory>
+#include <sstream>
 #include "pcap_structs.h"
 #include "Distributor.h"
+#include "Checkpoint.h"
+#include "Deduplicator.h"
+#include "PcapReader.h"
 
 #include "Utilities.h"
 
@@ -10,28 +16,103 @@ const uint8_t TCP_PROTOCOL = 0x06;
 const uint8_t UDP_PROTOCOL = 0x11;
 
 /**
- * @brief Parses command-line arguments and returns the file path.
+ * @brief Command-line options of the program.
+ */
+struct Options {
+    std::string pathToFile;            ///< Path to the input PCAP file.
+    bool resume = false;               ///< Continue from the last checkpoint.
+    uint64_t checkpointEvery = 1000000; ///< Packets between checkpoints, 0 disables them.
+    bool dedup = false;                ///< Drop duplicate packets before distribution.
+    uint32_t dedupWindowMs = 1000;     ///< Duplicate detection window in milliseconds.
+    size_t dedupMemoryMb = 16;         ///< Memory budget of the duplicate filter in MiB.
+    OutputOptions output;              ///< Where the handlers write packets.
+};
+
+/**
+ * @brief Prints usage information and terminates the program.
+ * @param progName Name of the executable.
+ */
+[[noreturn]] void usage(const char* progName) {
+    std::cout << "USAGE: " << progName << " <pathToFile> [--resume] [--checkpoint-every <packets>]\n"
+              << "       [--dedup] [--dedup-window <ms>] [--dedup-memory <MiB>]\n"
+              << "       [--rotate-size <MiB>] [--rotate-time <seconds>]\n"
+              << "       [--shm <name> | --udp <ip>:<port> | --unix <path>] [--shm-size <MiB>]\n"
+              << "       [--send-batch <packets>] [--pace <speed>]\n";
+    exit(1);
+}
+
+/**
+ * @brief Parses command-line arguments.
  * @param argc Number of arguments.
  * @param argv Argument values.
- * @return Path to the PCAP file.
+ * @return Parsed options.
  */
-std::string argParse(int argc, char* argv[]) {
-    if (argc != 2) {
-        std::cout << "USAGE: " << argv[0] << " <pathToFile>\n";
-        exit(1);
+Options argParse(int argc, char* argv[]) {
+    Options options;
+
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if (arg == "--resume") {
+            options.resume = true;
+        } else if (arg == "--checkpoint-every" && i + 1 < argc) {
+            options.checkpointEvery = std::strtoull(argv[++i], nullptr, 10);
+        } else if (arg == "--dedup") {
+            options.dedup = true;
+        } else if (arg == "--dedup-window" && i + 1 < argc) {
+            options.dedupWindowMs = std::strtoul(argv[++i], nullptr, 10);
+        } else if (arg == "--dedup-memory" && i + 1 < argc) {
+            options.dedupMemoryMb = std::strtoull(argv[++i], nullptr, 10);
+        } else if (arg == "--shm" && i + 1 < argc) {
+            options.output.shmName = argv[++i];
+        } else if (arg == "--shm-size" && i + 1 < argc) {
+            options.output.shmSize = std::strtoull(argv[++i], nullptr, 10) << 20;
+        } else if (arg == "--rotate-size" && i + 1 < argc) {
+            options.output.rotateBytes = std::strtoull(argv[++i], nullptr, 10) << 20;
+        } else if (arg == "--rotate-time" && i + 1 < argc) {
+            options.output.rotateSeconds = std::strtoul(argv[++i], nullptr, 10);
+        } else if (arg == "--udp" && i + 1 < argc) {
+            std::string udpAddr = argv[++i];
+            size_t colon = udpAddr.rfind(':');
+            unsigned long port = colon == std::string::npos ? 0 : 
+                                 std::strtoul(udpAddr.c_str() + colon + 1, nullptr, 10);
+            if (port == 0 || port > 65533) { // Three consecutive ports are used
+                usage(argv[0]);
+            }
+            options.output.udpIp = udpAddr.substr(0, colon);
+            options.output.udpPort = port;
+        } else if (arg == "--unix" && i + 1 < argc) {
+            options.output.unixPath = argv[++i];
+        } else if (arg == "--send-batch" && i + 1 < argc) {
+            options.output.sendBatch = std::strtoull(argv[++i], nullptr, 10);
+        } else if (arg == "--pace" && i + 1 < argc) {
+            options.output.paceSpeed = std::strtod(argv[++i], nullptr);
+        } else if (options.pathToFile.empty() && arg.rfind("--", 0) != 0) {
+            options.pathToFile = arg;
+        } else {
+            usage(argv[0]);
+        }
     }
 
-    return std::string(argv[1]);
+    // Only one output kind can be used, and rotation only applies to files
+    const OutputOptions& output = options.output;
+    int outputKinds = !output.udpIp.empty() + !output.unixPath.empty() + !output.shmName.empty();
+    if (options.pathToFile.empty() || outputKinds > 1 ||
+        (outputKinds && (output.rotateBytes || output.rotateSeconds))) {
+        usage(argv[0]);
+    }
+    return options;
 }
 
 /**
- * @brief Validates if the file has a .pcap suffix.
+ * @brief Validates if the file has a .pcap or .pcapng suffix.
  * @param pathToFile The file path to check.
- * @return True if the file has a valid .pcap suffix.
+ * @return True if the file has a valid suffix.
  */  
 bool hasPcapSuffix(std::string pathToFile) {
-    return pathToFile.size() >= 5 && 
-           pathToFile.substr(pathToFile.size() - 5) == ".pcap";
+    return (pathToFile.size() >= 5 && 
+            pathToFile.substr(pathToFile.size() - 5) == ".pcap") ||
+           (pathToFile.size() >= 7 && 
+            pathToFile.substr(pathToFile.size() - 7) == ".pcapng");
 }
 
 std::string getDirectory(const std::string& pathToFile) {
@@ -43,33 +124,15 @@ std::string getDirectory(const std::string& pathToFile) {
 }
 
 /**
- * @brief Reads and validates the PCAP global header.
- * @param pcapFs Input file stream.
- * @return The read PcapGlobalHdr.
+ * @brief Reads a single packet and parses its headers.
+ * @param reader Input file reader.
+ * @param packet Receives the parsed packet.
+ * @return False at the end of the file.
  */
-PcapGlobalHdr readPcapHeader(std::ifstream& pcapFs) {
-    PcapGlobalHdr globalHdr;
-    pcapFs.read((char*)&globalHdr, sizeof(globalHdr));
-
-    if (globalHdr.magicNumber != 0xA1B2C3D4) {
-        std::cerr << "\033[31mОшибка формата:\033[0m Некорректная структура заголовка pcap.\n";
-        pcapFs.close();
-        exit(1);
+bool readPacket(PcapReader& reader, PcapPacket& packet) {
+    if (!reader.next(packet)) {
+        return false;
     }
-    return globalHdr;
-}
-
-/**
- * @brief Parses a single packet from the file stream.
- * @param pcapFs Input file stream.
- * @return Parsed PcapPacket.
- */
-PcapPacket readPacket(std::ifstream& pcapFs) {
-    PcapPacket packet;
-    pcapFs.read((char *)&packet.pcapHdr, sizeof(packet.pcapHdr));
-
-    packet.data.resize(packet.pcapHdr.inclLen);
-    pcapFs.read(reinterpret_cast<char*>(packet.data.data()), packet.pcapHdr.inclLen);
 
     memcpy(&packet.ethHdr, &packet.data, sizeof(packet.ethHdr));
     memcpy(&packet.ipHdr, &packet.data[sizeof(packet.ethHdr)], sizeof(packet.ipHdr));
@@ -80,27 +143,61 @@ PcapPacket readPacket(std::ifstream& pcapFs) {
         memcpy(&packet.udpHdr, &packet.data[sizeof(packet.ethHdr) + sizeof(packet.ipHdr)], sizeof(packet.udpHdr));
     } else {
         std::cerr << "\033[31mОшибка протокола:\033[0m Неподдерживаемый протокол (номер протокола: " << std::hex << "0x" << (int) packet.ipHdr.protocol << std::dec << "). Ожидался TCP (0x06) или UDP (0x11)." << std::endl;
-        pcapFs.close();
         exit(1);
     }
-    return packet;
+    return true;
 }
 
 /**
  * @brief Reads and processes packets from a PCAP file.
- * @param pcapFs Input file stream.
+ * @param reader Input file reader.
  * @param distributor Distributor instance.
+ * @param dedup Duplicate filter, or nullptr if deduplication is off.
+ * @param options Command-line options.
+ * @param checkpoint Checkpoint template with the input size set.
+ * @param checkpointPath Path to the checkpoint file.
+ *
+ * @details Every `options.checkpointEvery` packets the handlers 
+ *          are drained and a checkpoint with the current input 
+ *          offset is saved.
  */
-void processPcapFile(std::ifstream& pcapFs, Distributor& distributor) {
-    while (pcapFs.peek() != EOF) {
-        distributor.distrPacket(readPacket(pcapFs));
+void processPcapFile(PcapReader& reader, Distributor& distributor,
+                     Deduplicator* dedup, const Options& options, 
+                     Checkpoint checkpoint, const std::string& checkpointPath) {
+    uint64_t packetNum = 0;
+
+    PcapPacket packet;
+    while (readPacket(reader, packet)) {
+        if (!dedup || !dedup->isDuplicate(packet)) {
+            distributor.distrPacket(std::move(packet));
+        }
+
+        if (options.checkpointEvery && ++packetNum % options.checkpointEvery == 0) {
+            if (!distributor.checkpoint(checkpoint)) {
+                std::cerr << "\033[31mОшибка файла:\033[0m Не удалось сбросить результаты на диск, контрольная точка не сохранена\n";
+                continue;
+            }
+            checkpoint.inputOffset = reader.offset();
+            std::ostringstream readerState;
+            reader.saveState(readerState);
+            checkpoint.readerState = readerState.str();
+            if (dedup) {
+                std::ostringstream state;
+                dedup->saveState(state);
+                checkpoint.dedupState = state.str();
+            }
+            if (!writeCheckpoint(checkpointPath, checkpoint)) {
+                std::cerr << "\033[31mОшибка файла:\033[0m Не удалось сохранить контрольную точку \"" << checkpointPath << "\"\n";
+            }
+        }
     }
 }
 
 int main(int argc, char* argv[]) {
-    std::string pathToFile = argParse(argc, argv);
+    Options options = argParse(argc, argv);
+    const std::string& pathToFile = options.pathToFile;
     if (!hasPcapSuffix(pathToFile)) {
-        std::cerr << "\033[31mОшибка файла:\033[0m Неверный суффикс. Ожидался .pcap.\n";
+        std::cerr << "\033[31mОшибка файла:\033[0m Неверный суффикс. Ожидался .pcap или .pcapng.\n";
         return 1;
     }    
     
@@ -113,11 +210,68 @@ int main(int argc, char* argv[]) {
     }
 
     std::string fileDir = getDirectory(pathToFile);
+    std::string checkpointPath = fileDir + "/ddist.checkpoint";
+
+    Checkpoint checkpoint;
+    pcapFs.seekg(0, std::ios::end);
+    checkpoint.inputSize = pcapFs.tellg();
+    pcapFs.seekg(0, std::ios::beg);
+    checkpoint.outputKind = options.output.kind();
+    checkpoint.rotateBytes = options.output.rotateBytes;
+    checkpoint.rotateSeconds = options.output.rotateSeconds;
 
-    Distributor distributor(readPcapHeader(pcapFs), fileDir);
+    PcapReader reader(pcapFs);
+    const PcapGlobalHdr& globalHdr = reader.globalHdr();
+
+    Checkpoint resumePoint;
+    const Checkpoint* resume = nullptr;
+    if (options.resume) {
+        bool found = readCheckpoint(checkpointPath, resumePoint);
+        std::istringstream readerState(resumePoint.readerState);
+        if (!found) {
+            std::cout << "Контрольная точка не найдена, обработка начинается с начала файла\n";
+        } else if (resumePoint.inputSize != checkpoint.inputSize || 
+                   resumePoint.inputOffset > checkpoint.inputSize ||
+                   resumePoint.handlers.size() != 3 ||
+                   !reader.loadState(readerState)) {
+            std::cerr << "\033[31mОшибка файла:\033[0m Контрольная точка \"" << checkpointPath << "\" не соответствует файлу " << pathToFile << "\n";
+            return 1;
+        } else if (resumePoint.outputKind != checkpoint.outputKind ||
+                   resumePoint.rotateBytes != checkpoint.rotateBytes ||
+                   resumePoint.rotateSeconds != checkpoint.rotateSeconds) {
+            std::cerr << "\033[31mОшибка файла:\033[0m Контрольная точка \"" << checkpointPath << "\" сохранена с другими настройками вывода\n";
+            return 1;
+        } else {
+            resume = &resumePoint;
+            reader.seek(resumePoint.inputOffset);
+        }
+    } else {
+        // A checkpoint of an earlier run does not match the outputs of this one
+        std::remove(checkpointPath.c_str());
+    }
+
+    std::unique_ptr<Deduplicator> dedup;
+    if (options.dedup) {
+        dedup.reset(new Deduplicator(globalHdr, options.dedupWindowMs, options.dedupMemoryMb << 20));
+        if (resume) {
+            std::istringstream state(resume->dedupState);
+            dedup->loadState(state);
+        }
+    }
+
+    Distributor distributor(globalHdr, fileDir, options.output, resume);
     distributor.start();
 
-    processPcapFile(pcapFs, distributor);
+    processPcapFile(reader, distributor, dedup.get(), options, checkpoint, checkpointPath);
+    distributor.stop();
+
+    if (dedup) {
+        std::cout << "Удалено дубликатов: " << dedup->duplicateNum() 
+                  << " из " << dedup->packetNum() << " пакетов\n";
+    }
+
+    // The run is complete, the checkpoint is no longer needed
+    std::remove(checkpointPath.c_str());
 
     pcapFs.close();
     return 0;